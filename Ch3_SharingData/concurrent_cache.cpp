@@ -0,0 +1,74 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_cache.hpp"
+
+struct dns_entry {
+    std::string data;
+};
+
+int main()
+{
+    // resolver-like workload: a few popular domains and a long tail, far more domains than
+    // fit into the cache
+    constexpr auto domain_count{200000};
+    constexpr auto lookups_per_thread{500000};
+    auto const thread_count{std::max(std::thread::hardware_concurrency(), 4u)};
+
+    std::vector<std::string> domains{};
+    domains.reserve(domain_count);
+    for (auto i{0}; i != domain_count; ++i) {
+        domains.push_back("host" + std::to_string(i) + ".example.com");
+    }
+
+    concurrent_cache<std::string, dns_entry> cache{20000};
+    std::atomic<long> resolved{0};
+    auto const start{std::chrono::steady_clock::now()};
+    std::vector<std::thread> threads{};
+    for (auto t{0u}; t != thread_count; ++t) {
+        threads.emplace_back([&domains, &cache, &resolved, t] {
+            std::minstd_rand rng{t + 1};
+            std::uniform_real_distribution<double> exponent{0.0, 1.0};
+            for (auto i{0}; i != lookups_per_thread; ++i) {
+                // log-uniform: domain k is looked up about 1/k as often as domain 0
+                auto const index{static_cast<std::size_t>(
+                                     std::pow(double{domain_count}, exponent(rng))) -
+                                 1};
+                auto const& domain{domains[index]};
+                if (!cache.find(domain)) {
+                    // a miss goes to the upstream server
+                    resolved.fetch_add(1, std::memory_order_relaxed);
+                    cache.insert(domain, dns_entry{domain + " details"}, std::chrono::seconds{30});
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const elapsed{std::chrono::duration<double>{std::chrono::steady_clock::now() - start}};
+
+    auto const stats{cache.stats()};
+    auto const lookups{static_cast<double>(stats.hits + stats.misses)};
+    std::cerr << thread_count << " threads: " << std::fixed << std::setprecision(2)
+              << lookups / elapsed.count() / 1e6 << " M lookups/s, hit rate "
+              << std::setprecision(1) << 100.0 * static_cast<double>(stats.hits) / lookups
+              << "%, " << stats.evictions << " evictions, " << stats.size << " of "
+              << cache.capacity() << " entries used, " << resolved.load()
+              << " upstream queries\n";
+
+    // entries disappear once their time to live is over
+    concurrent_cache<std::string, dns_entry> short_lived{16};
+    short_lived.insert("foo", dns_entry{"foo_domain_detail"}, std::chrono::milliseconds{50});
+    short_lived.insert("bar", dns_entry{"bar_domain_detail"});
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    std::cerr << "after 100ms: foo " << (short_lived.find("foo") ? "cached" : "expired")
+              << ", bar " << (short_lived.find("bar") ? "cached" : "expired") << "\n";
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * concurrent_cache is the dns_cache from shared_access.cpp grown into a reusable component: a
+ * fixed-capacity key/value cache for many concurrent readers.
+ *
+ * The keys are spread over independent shards, each one a map guarded by its own
+ * std::shared_mutex, so threads looking up different keys rarely touch the same lock. A shard
+ * never holds more than its share of the capacity. Once it is full, inserting evicts an entry
+ * chosen by the CLOCK algorithm: every entry has a `referenced` bit that a hit sets, and the
+ * clock hand sweeps over the entries clearing these bits until it finds one that hasn't been
+ * used since the last sweep. Setting the bit is a relaxed store (skipped if it is already
+ * set), so a hit only needs the shared lock - unlike LRU, which reorders a list on every hit.
+ *
+ * Entries may be given a time to live. Expired entries are reported as misses and are the
+ * first to go when the clock hand passes them.
+ */
+
+struct cache_stats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    // entries dropped to make room for new ones
+    std::uint64_t evictions{0};
+    // entries dropped because their time to live was over
+    std::uint64_t expirations{0};
+    std::size_t size{0};
+};
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+         typename Clock = std::chrono::steady_clock>
+class concurrent_cache {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using clock = Clock;
+    using duration = typename Clock::duration;
+
+    static constexpr std::size_t default_shard_count{16};
+
+    // capacity is the total number of entries, split evenly between the shards
+    explicit concurrent_cache(std::size_t capacity, std::size_t shard_count = default_shard_count,
+                              Hash const& hasher = Hash{})
+        : hasher_{hasher}
+        , shard_count_{std::clamp(shard_count, std::size_t{1}, std::max(capacity, std::size_t{1}))}
+        , shards_{std::make_unique<shard[]>(shard_count_)}
+    {
+        auto const shard_capacity{std::max((capacity + shard_count_ - 1) / shard_count_,
+                                           std::size_t{1})};
+        for (std::size_t i{0}; i != shard_count_; ++i) {
+            shards_[i].init(shard_capacity, hasher_);
+        }
+    }
+
+    concurrent_cache(concurrent_cache const&) = delete;
+    concurrent_cache& operator=(concurrent_cache const&) = delete;
+
+    ~concurrent_cache() noexcept = default;
+
+    std::optional<Value> find(Key const& key) const
+    {
+        auto& s{shard_for(key)};
+        std::shared_lock<std::shared_mutex> lock{s.mutex};
+        auto const it{s.entries.find(key)};
+        if (it == s.entries.end() || it->second.expired()) {
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        auto& e{it->second};
+        // don't dirty the cache line if the bit is already set - hot entries almost always are
+        if (!e.referenced.load(std::memory_order_relaxed)) {
+            e.referenced.store(true, std::memory_order_relaxed);
+        }
+        s.hits.fetch_add(1, std::memory_order_relaxed);
+        return e.value;
+    }
+
+    // Adds or replaces the entry for key, evicting another entry if the shard is full.
+    void insert(Key const& key, Value value)
+    {
+        insert_entry(key, std::move(value), time_point::max());
+    }
+
+    // As above, but the entry expires once ttl has passed.
+    void insert(Key const& key, Value value, duration ttl)
+    {
+        insert_entry(key, std::move(value), Clock::now() + ttl);
+    }
+
+    bool erase(Key const& key)
+    {
+        auto& s{shard_for(key)};
+        std::lock_guard<std::shared_mutex> lock{s.mutex};
+        auto const it{s.entries.find(key)};
+        if (it == s.entries.end()) {
+            return false;
+        }
+        s.remove(it);
+        return true;
+    }
+
+    std::size_t capacity() const noexcept { return shard_count_ * shards_[0].capacity; }
+
+    std::size_t size() const
+    {
+        std::size_t res{0};
+        for (std::size_t i{0}; i != shard_count_; ++i) {
+            std::shared_lock<std::shared_mutex> lock{shards_[i].mutex};
+            res += shards_[i].entries.size();
+        }
+        return res;
+    }
+
+    // the counters are summed up shard by shard, so this isn't an atomic snapshot
+    cache_stats stats() const
+    {
+        cache_stats res{};
+        for (std::size_t i{0}; i != shard_count_; ++i) {
+            auto const& s{shards_[i]};
+            res.hits += s.hits.load(std::memory_order_relaxed);
+            res.misses += s.misses.load(std::memory_order_relaxed);
+            res.evictions += s.evictions.load(std::memory_order_relaxed);
+            res.expirations += s.expirations.load(std::memory_order_relaxed);
+        }
+        res.size = size();
+        return res;
+    }
+
+private:
+    using time_point = typename Clock::time_point;
+
+    struct entry {
+        Value value;
+        time_point expires;
+        std::atomic<bool> referenced{false};
+        // position in the shard's clock
+        std::size_t slot{0};
+
+        entry(Value v, time_point e, std::size_t s) : value{std::move(v)}, expires{e}, slot{s} {}
+
+        bool expired() const
+        {
+            return expires != time_point::max() && expires <= Clock::now();
+        }
+    };
+
+    using map_type = std::unordered_map<Key, entry, Hash>;
+
+    struct alignas(64) shard {
+        std::shared_mutex mutex{};
+        map_type entries{};
+        // The clock: every slot points to an entry of the map. Slots are only appended until
+        // the shard is full and are reused from then on, entries are never moved by the map.
+        std::vector<typename map_type::value_type*> slots{};
+        // slots freed by erase()
+        std::vector<std::size_t> free_slots{};
+        std::size_t hand{0};
+        std::size_t capacity{0};
+        std::atomic<std::uint64_t> hits{0};
+        std::atomic<std::uint64_t> misses{0};
+        std::atomic<std::uint64_t> evictions{0};
+        std::atomic<std::uint64_t> expirations{0};
+
+        void init(std::size_t shard_capacity, Hash const& hasher)
+        {
+            capacity = shard_capacity;
+            // all memory up front - a full shard never rehashes or grows
+            entries = map_type{shard_capacity, hasher};
+            slots.reserve(shard_capacity);
+            free_slots.reserve(shard_capacity);
+        }
+
+        void remove(typename map_type::iterator it)
+        {
+            auto const slot{it->second.slot};
+            slots[slot] = nullptr;
+            free_slots.push_back(slot);
+            entries.erase(it);
+        }
+
+        // a slot for a new entry, evicting one if the shard is full
+        std::size_t claim_slot()
+        {
+            if (slots.size() != capacity) {
+                slots.push_back(nullptr);
+                return slots.size() - 1;
+            }
+            if (!free_slots.empty()) {
+                auto const slot{free_slots.back()};
+                free_slots.pop_back();
+                return slot;
+            }
+            // every entry is referenced at most once before the hand clears it, so this ends
+            // within two turns
+            for (;;) {
+                auto const slot{hand};
+                hand = hand + 1 == capacity ? 0 : hand + 1;
+                auto& e{slots[slot]->second};
+                if (e.expired()) {
+                    expirations.fetch_add(1, std::memory_order_relaxed);
+                }
+                else if (e.referenced.exchange(false, std::memory_order_relaxed)) {
+                    continue;
+                }
+                else {
+                    evictions.fetch_add(1, std::memory_order_relaxed);
+                }
+                entries.erase(slots[slot]->first);
+                slots[slot] = nullptr;
+                return slot;
+            }
+        }
+    };
+
+    shard& shard_for(Key const& key) const
+    {
+        // the shard maps use the low bits of the hash for their buckets - pick the shard by the
+        // high bits, so that a shard's keys still spread over all of its buckets
+        auto const h{static_cast<std::uint64_t>(hasher_(key)) * 0x9e3779b97f4a7c15ull};
+        return shards_[static_cast<std::size_t>(h >> 32) % shard_count_];
+    }
+
+    void insert_entry(Key const& key, Value&& value, time_point expires)
+    {
+        auto& s{shard_for(key)};
+        std::lock_guard<std::shared_mutex> lock{s.mutex};
+        if (auto const it{s.entries.find(key)}; it != s.entries.end()) {
+            it->second.value = std::move(value);
+            it->second.expires = expires;
+            it->second.referenced.store(true, std::memory_order_relaxed);
+            return;
+        }
+        auto const slot{s.claim_slot()};
+        try {
+            s.slots[slot] = &*s.entries.try_emplace(key, std::move(value), expires, slot).first;
+        }
+        catch (...) {
+            s.free_slots.push_back(slot);
+            throw;
+        }
+    }
+
+    // --- member data
+    Hash hasher_{};
+    std::size_t shard_count_;
+    std::unique_ptr<shard[]> shards_;
+};
@@ -0,0 +1,309 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation - the read-side-cheap alternative to hazard pointers.
+//
+// A thread pins the current global epoch for the duration of an operation: a single store to
+// a slot only that thread writes, plus a fence. It never has to publish individual pointers.
+// Unlinked nodes are retired into one of three per-thread bags, according to the epoch they
+// were retired in. The global epoch can only move from e to e+1 once every pinned thread has
+// observed e, so by the time it reaches e+2 no thread can still be reading a node retired
+// during e, and that bag can be freed.
+//
+// The price is robustness: a thread that stays pinned (or stalls while pinned) stops the epoch
+// from advancing, and then nothing gets reclaimed. Hazard pointers don't have that problem.
+
+class epoch_domain {
+public:
+    struct thread_record {
+        // (epoch << 1) | 1 while pinned, 0 while quiescent
+        std::atomic<std::uint64_t> state{0};
+        std::atomic<bool> in_use{false};
+        thread_record* next{nullptr};
+    };
+
+    struct retired_pointer {
+        void* pointer;
+        void (*deleter)(void*);
+    };
+
+    static epoch_domain& instance()
+    {
+        static epoch_domain domain{};
+        return domain;
+    }
+
+    epoch_domain(epoch_domain const&) = delete;
+    epoch_domain& operator=(epoch_domain const&) = delete;
+
+    ~epoch_domain() noexcept
+    {
+        // only reached on program exit - nobody can be pinned anymore
+        for (auto const& orphan : orphans_) {
+            for (auto const& retired : orphan.second) {
+                retired.deleter(retired.pointer);
+            }
+        }
+        auto* record{records_.load()};
+        while (record) {
+            delete std::exchange(record, record->next);
+        }
+    }
+
+    std::uint64_t current_epoch() const noexcept
+    {
+        return global_epoch_.load(std::memory_order_acquire);
+    }
+
+    thread_record* acquire_record()
+    {
+        for (auto* record{records_.load(std::memory_order_acquire)}; record;
+             record = record->next) {
+            bool expected{false};
+            if (!record->in_use.load(std::memory_order_relaxed) &&
+                record->in_use.compare_exchange_strong(expected, true)) {
+                return record;
+            }
+        }
+        auto* const record{new thread_record{}};
+        record->in_use.store(true, std::memory_order_relaxed);
+        record->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                               std::memory_order_relaxed))
+            ;
+        return record;
+    }
+
+    void release_record(thread_record* record) noexcept
+    {
+        record->state.store(0, std::memory_order_release);
+        record->in_use.store(false, std::memory_order_release);
+    }
+
+    // Moves the global epoch forward if every pinned thread has caught up with it.
+    // Returns the (possibly new) global epoch.
+    std::uint64_t try_advance()
+    {
+        auto epoch{global_epoch_.load(std::memory_order_acquire)};
+        // pairs with the fence in epoch_guard's constructor
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto* record{records_.load(std::memory_order_acquire)}; record;
+             record = record->next) {
+            auto const state{record->state.load(std::memory_order_acquire)};
+            if ((state & 1u) && (state >> 1) != epoch) {
+                return epoch;
+            }
+        }
+        if (global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel)) {
+            ++epoch;
+        }
+        collect_orphans(epoch);
+        return epoch;
+    }
+
+    // called on thread exit with the bags that weren't safe to free yet
+    void add_orphans(std::uint64_t epoch, std::vector<retired_pointer>&& retired)
+    {
+        if (retired.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{orphans_mutex_};
+        orphans_.emplace_back(epoch, std::move(retired));
+        has_orphans_.store(true, std::memory_order_release);
+    }
+
+    void note_retired(std::size_t count) noexcept
+    {
+        retired_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void note_reclaimed(std::size_t count) noexcept
+    {
+        reclaimed_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Approximate number of retired nodes that haven't been deleted yet.
+    std::size_t pending_reclamation() const noexcept
+    {
+        return retired_.load(std::memory_order_relaxed) -
+               reclaimed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    epoch_domain() = default;
+
+    void collect_orphans(std::uint64_t epoch)
+    {
+        if (!has_orphans_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock{orphans_mutex_, std::try_to_lock};
+        if (!lock.owns_lock()) {
+            return;
+        }
+        auto it{orphans_.begin()};
+        while (it != orphans_.end()) {
+            if (it->first + 2 <= epoch) {
+                for (auto const& retired : it->second) {
+                    retired.deleter(retired.pointer);
+                }
+                note_reclaimed(it->second.size());
+                it = orphans_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        has_orphans_.store(!orphans_.empty(), std::memory_order_relaxed);
+    }
+
+    // --- member data
+    alignas(64) std::atomic<std::uint64_t> global_epoch_{0};
+    alignas(64) std::atomic<thread_record*> records_{nullptr};
+    std::atomic<std::size_t> retired_{0};
+    std::atomic<std::size_t> reclaimed_{0};
+    std::atomic<bool> has_orphans_{false};
+    std::mutex orphans_mutex_{};
+    std::vector<std::pair<std::uint64_t, std::vector<retired_pointer>>> orphans_{};
+};
+
+// Per-thread epoch slot, pin nesting depth and limbo bags.
+class epoch_thread_state {
+public:
+    static constexpr unsigned collect_interval{64};
+
+    static epoch_thread_state& instance()
+    {
+        static thread_local epoch_thread_state state{};
+        return state;
+    }
+
+    epoch_thread_state(epoch_thread_state const&) = delete;
+    epoch_thread_state& operator=(epoch_thread_state const&) = delete;
+
+    ~epoch_thread_state() noexcept
+    {
+        auto& domain{epoch_domain::instance()};
+        domain.release_record(record_);
+        domain.note_retired(unreported_);
+        collect(domain.try_advance());
+        for (auto& bag : bags_) {
+            domain.add_orphans(bag.epoch, std::move(bag.retired));
+        }
+    }
+
+    void pin() noexcept
+    {
+        if (nesting_++ == 0) {
+            auto const epoch{epoch_domain::instance().current_epoch()};
+            record_->state.store((epoch << 1) | 1u, std::memory_order_relaxed);
+            // the pin has to be visible before we read anything from the data structure
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void unpin() noexcept
+    {
+        if (--nesting_ == 0) {
+            record_->state.store(0, std::memory_order_release);
+        }
+    }
+
+    void retire(void* pointer, void (*deleter)(void*))
+    {
+        auto& domain{epoch_domain::instance()};
+        auto const epoch{domain.current_epoch()};
+        auto& bag{bags_[epoch % bags_.size()]};
+        if (bag.epoch != epoch) {
+            // the bag's previous contents are at least three epochs old
+            free_bag(bag);
+            bag.epoch = epoch;
+        }
+        bag.retired.push_back({pointer, deleter});
+        ++unreported_;
+        if (++retire_count_ % collect_interval == 0) {
+            domain.note_retired(std::exchange(unreported_, 0));
+            collect(domain.try_advance());
+        }
+    }
+
+private:
+    struct bag_type {
+        std::uint64_t epoch{0};
+        std::vector<epoch_domain::retired_pointer> retired{};
+    };
+
+    epoch_thread_state() : record_{epoch_domain::instance().acquire_record()} {}
+
+    void collect(std::uint64_t global_epoch)
+    {
+        for (auto& bag : bags_) {
+            if (bag.epoch + 2 <= global_epoch) {
+                free_bag(bag);
+            }
+        }
+    }
+
+    void free_bag(bag_type& bag)
+    {
+        for (auto const& retired : bag.retired) {
+            retired.deleter(retired.pointer);
+        }
+        epoch_domain::instance().note_reclaimed(bag.retired.size());
+        bag.retired.clear();
+    }
+
+    epoch_domain::thread_record* record_;
+    unsigned nesting_{0};
+    unsigned retire_count_{0};
+    std::size_t unreported_{0};
+    std::array<bag_type, 3> bags_{};
+};
+
+// RAII pin of the current epoch - everything loaded while it's alive stays alive.
+class epoch_guard {
+public:
+    epoch_guard() noexcept { epoch_thread_state::instance().pin(); }
+    epoch_guard(epoch_guard const&) = delete;
+    epoch_guard& operator=(epoch_guard const&) = delete;
+    ~epoch_guard() noexcept { epoch_thread_state::instance().unpin(); }
+
+    // being pinned already protects everything - a plain load will do
+    template <typename T>
+    T* protect(std::atomic<T*> const& src) noexcept
+    {
+        return src.load(std::memory_order_acquire);
+    }
+
+    template <typename T>
+    void set(T*) noexcept
+    {
+    }
+
+    // the pin is kept until the guard is destroyed
+    void reset() noexcept {}
+};
+
+// Reclaimer policy - same interface as hazard_pointer_reclaimer.
+struct epoch_reclaimer {
+    using guard = epoch_guard;
+    static constexpr bool guard_protects_all{true};
+
+    template <typename T>
+    static void retire(T* pointer)
+    {
+        epoch_thread_state::instance().retire(pointer,
+                                              [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    static std::size_t pending_reclamation() noexcept
+    {
+        return epoch_domain::instance().pending_reclamation();
+    }
+};
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rcu_ptr.hpp"
+
+struct dns_entry {
+    std::string data;
+};
+
+// the dns_cache from shared_access.cpp
+class locked_dns_cache {
+public:
+    dns_entry find_entry(std::string const& domain) const
+    {
+        std::shared_lock<std::shared_mutex> lock{entry_mutex_};
+        auto const it = entries_.find(domain);
+        if (it != std::cend(entries_)) {
+            return it->second;
+        }
+        return {};
+    }
+
+    void update_or_add_entry(std::string const& domain, dns_entry const& dns_detail)
+    {
+        std::lock_guard<std::shared_mutex> lock{entry_mutex_};
+        entries_.insert_or_assign(domain, dns_detail);
+    }
+
+private:
+    std::unordered_map<std::string, dns_entry> entries_{};
+    mutable std::shared_mutex entry_mutex_{};
+};
+
+// The same cache with the table published through rcu_ptr: lookups don't lock anything,
+// every update publishes a new copy of the table.
+class dns_cache {
+public:
+    using table_type = std::unordered_map<std::string, dns_entry>;
+
+    dns_entry find_entry(std::string const& domain) const
+    {
+        return entries_.read([&domain](table_type const& entries) {
+            auto const it = entries.find(domain);
+            return it != std::cend(entries) ? it->second : dns_entry{};
+        });
+    }
+
+    void update_or_add_entry(std::string const& domain, dns_entry const& dns_detail)
+    {
+        entries_.update([&](table_type& entries) { entries.insert_or_assign(domain, dns_detail); });
+    }
+
+    // copying the table is what an update costs, so batch them up
+    void update_or_add_entries(std::vector<std::pair<std::string, dns_entry>> const& details)
+    {
+        entries_.update([&details](table_type& entries) {
+            for (auto const& [domain, detail] : details) {
+                entries.insert_or_assign(domain, detail);
+            }
+        });
+    }
+
+private:
+    rcu_ptr<table_type> entries_{};
+};
+
+// any read-mostly structure works - readers see all of a config change or none of it
+struct server_config {
+    std::string upstream{"10.0.0.1"};
+    int timeout_ms{500};
+    int retries{3};
+};
+
+namespace
+{
+template<typename Cache>
+double lookups_per_second(unsigned reader_count)
+{
+    constexpr auto domain_count{1000};
+    constexpr auto run_time{std::chrono::milliseconds{300}};
+
+    Cache cache{};
+    for (auto i{0}; i != domain_count; ++i) {
+        cache.update_or_add_entry("host" + std::to_string(i), dns_entry{"initial details"});
+    }
+    std::atomic_bool done{false};
+    std::atomic<long> lookups{0};
+    std::vector<std::thread> threads{};
+    for (auto r{0u}; r != reader_count; ++r) {
+        threads.emplace_back([&cache, &done, &lookups, r] {
+            std::string domain{};
+            long count{0};
+            for (auto i{r}; !done.load(std::memory_order_relaxed); ++i) {
+                domain = "host" + std::to_string(i % domain_count);
+                count += !cache.find_entry(domain).data.empty();
+            }
+            lookups.fetch_add(count);
+        });
+    }
+    // the rare writer
+    threads.emplace_back([&cache, &done] {
+        for (auto i{0}; !done.load(); ++i) {
+            cache.update_or_add_entry("host" + std::to_string(i % domain_count),
+                                      dns_entry{"NEW details"});
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    });
+    std::this_thread::sleep_for(run_time);
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    return static_cast<double>(lookups.load()) / std::chrono::duration<double>{run_time}.count();
+}
+} // namespace
+
+int main()
+{
+    dns_cache cache{};
+    cache.update_or_add_entries({{"foo", dns_entry{"foo_domain_detail"}},
+                                 {"bar", dns_entry{"bar_domain_detail"}},
+                                 {"baz", dns_entry{"baz_domain_detail"}}});
+    cache.update_or_add_entry("foo", dns_entry{"NEW foo details"});
+    std::cerr << "foo: " << cache.find_entry("foo").data << ", bar: " << cache.find_entry("bar").data
+              << ", ni: '" << cache.find_entry("ni").data << "'\n";
+
+    rcu_ptr<server_config> config{};
+    {
+        // a snapshot stays the same while the config is being changed
+        auto const before{config.read()};
+        config.update([](server_config& c) {
+            c.upstream = "10.0.0.2";
+            c.timeout_ms = 250;
+        });
+        std::cerr << "config while updating: " << before->upstream << " " << before->timeout_ms
+                  << "ms, afterwards: " << config.read()->upstream << " "
+                  << config.read()->timeout_ms << "ms\n";
+    }
+
+    auto const max_readers{std::max(std::thread::hardware_concurrency(), 4u)};
+    std::cerr << std::setw(8) << "readers" << std::setw(16) << "shared_mutex" << std::setw(16)
+              << "rcu_ptr" << "    (M lookups/s)\n";
+    for (auto readers{1u}; readers <= max_readers; readers *= 2) {
+        std::cerr << std::setw(8) << readers << std::fixed << std::setprecision(2)
+                  << std::setw(16) << lookups_per_second<locked_dns_cache>(readers) / 1e6
+                  << std::setw(16) << lookups_per_second<dns_cache>(readers) / 1e6 << "\n";
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "epoch_reclaimer.hpp"
+
+/**
+ * rcu_ptr publishes an immutable T for read-mostly data - routing or config tables, the DNS
+ * cache - the way read-copy-update does.
+ *
+ * A reader pins the current epoch and loads the pointer with a single acquire load; what it
+ * gets is a snapshot that stays valid and unchanged for as long as it holds on to it. No lock,
+ * no retry loop and no reference count is involved, so reads are wait-free and readers never
+ * write to a cache line that another thread writes to. (std::atomic<std::shared_ptr> would
+ * have every reader bump the same reference count - and isn't lock-free in the common
+ * standard libraries.)
+ *
+ * Writers never modify a published T. update() copies the current version, applies any number
+ * of changes to the copy and publishes it in one go; the old version is handed to the epoch
+ * reclaimer and deleted once every reader that could still see it is done - the grace period.
+ * Writers are serialised by a mutex, so concurrent updates don't get lost.
+ */
+
+template<typename T>
+class rcu_ptr {
+public:
+    /**
+     * A pinned, immutable version of the data. Readers should hold on to it only briefly: while
+     * any snapshot is alive, no retired version anywhere can be reclaimed.
+     */
+    class snapshot {
+    public:
+        snapshot(snapshot const&) = delete;
+        snapshot& operator=(snapshot const&) = delete;
+
+        T const& operator*() const noexcept { return *data_; }
+        T const* operator->() const noexcept { return data_; }
+        T const* get() const noexcept { return data_; }
+
+    private:
+        friend class rcu_ptr;
+
+        explicit snapshot(std::atomic<T const*> const& src) : data_{guard_.protect(src)} {}
+
+        epoch_guard guard_{};
+        T const* data_;
+    };
+
+    explicit rcu_ptr(T initial = T{}) : current_{new T(std::move(initial))} {}
+
+    rcu_ptr(rcu_ptr const&) = delete;
+    rcu_ptr& operator=(rcu_ptr const&) = delete;
+
+    ~rcu_ptr() noexcept
+    {
+        // no reader may be left - older versions are the reclaimer's
+        delete current_.load(std::memory_order_relaxed);
+    }
+
+    snapshot read() const { return snapshot{current_}; }
+
+    // Calls f with the current version and returns its result; f must not let the reference
+    // escape.
+    template<typename Function>
+    decltype(auto) read(Function&& f) const
+    {
+        auto const s{read()};
+        return std::forward<Function>(f)(*s);
+    }
+
+    // Publishes a copy of the current version that f(T&) has modified.
+    template<typename Function>
+    void update(Function&& f)
+    {
+        std::lock_guard<std::mutex> lock{writer_mutex_};
+        auto next{std::make_unique<T>(*current_.load(std::memory_order_relaxed))};
+        std::forward<Function>(f)(*next);
+        publish(std::move(next));
+    }
+
+    // Replaces the current version altogether; next must not be null.
+    void store(std::unique_ptr<T> next)
+    {
+        std::lock_guard<std::mutex> lock{writer_mutex_};
+        publish(std::move(next));
+    }
+
+private:
+    // the caller holds writer_mutex_
+    void publish(std::unique_ptr<T> next)
+    {
+        auto const* const old{current_.exchange(next.release(), std::memory_order_acq_rel)};
+        // readers may still be looking at it
+        epoch_reclaimer::retire(const_cast<T*>(old));
+    }
+
+    std::atomic<T const*> current_;
+    std::mutex writer_mutex_{};
+};
@@ -0,0 +1,213 @@
+#if !defined(NODE_ALLOCATOR_HPP_)
+#define NODE_ALLOCATOR_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Allocator for node-based containers that allocate and free one node at a time.
+//
+// Every thread keeps a cache of free blocks per block size, so a node allocation is usually
+// a pop off a thread-local free list and involves no locking at all. Blocks move between the
+// thread caches and a global pool a batch at a time: a thread that runs dry takes a whole
+// batch, a thread that has freed two batches' worth gives one back. Threads that produce
+// nodes which other threads free (queues!) thus don't hoard memory, and the global pool's
+// mutex is taken once per batch_size nodes.
+// Memory is never handed back to the system before program exit - the pools only grow up to
+// the largest number of nodes that were ever alive at the same time.
+
+namespace node_allocator_detail {
+
+struct free_block {
+    free_block* next;
+};
+
+// a chain of free blocks
+struct block_batch {
+    free_block* head{nullptr};
+    std::size_t size{0};
+};
+
+// Global pool of all blocks of one size and alignment.
+template <std::size_t Size, std::size_t Alignment>
+class block_pool {
+  public:
+    static constexpr std::size_t batch_size{64};
+    static constexpr std::size_t block_alignment{std::max(Alignment, alignof(free_block))};
+    static constexpr std::size_t block_size{
+        (std::max(Size, sizeof(free_block)) + block_alignment - 1) / block_alignment *
+        block_alignment};
+
+    static block_pool& instance()
+    {
+        static block_pool pool{};
+        return pool;
+    }
+
+    block_pool(block_pool const&) = delete;
+    block_pool& operator=(block_pool const&) = delete;
+
+    ~block_pool() noexcept
+    {
+        for (auto* chunk : chunks_) {
+            ::operator delete(chunk, std::align_val_t{block_alignment});
+        }
+    }
+
+    block_batch take_batch()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (!batches_.empty()) {
+                auto const batch{batches_.back()};
+                batches_.pop_back();
+                return batch;
+            }
+        }
+        return carve_chunk();
+    }
+
+    void give_batch(block_batch batch)
+    {
+        if (batch.size == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{mutex_};
+        batches_.push_back(batch);
+    }
+
+  private:
+    block_pool() = default;
+
+    // fresh memory for a whole batch in a single allocation
+    block_batch carve_chunk()
+    {
+        auto* const chunk{static_cast<unsigned char*>(
+            ::operator new(block_size * batch_size, std::align_val_t{block_alignment}))};
+        try {
+            std::lock_guard<std::mutex> lock{mutex_};
+            chunks_.push_back(chunk);
+        }
+        catch (...) {
+            ::operator delete(chunk, std::align_val_t{block_alignment});
+            throw;
+        }
+        block_batch batch{nullptr, batch_size};
+        for (auto i{batch_size}; i-- != 0;) {
+            batch.head = ::new (chunk + i * block_size) free_block{batch.head};
+        }
+        return batch;
+    }
+
+    // --- member data
+    std::mutex mutex_{};
+    std::vector<block_batch> batches_{};
+    std::vector<unsigned char*> chunks_{};
+};
+
+// The calling thread's cache in front of block_pool: the blocks currently handed out from,
+// plus at most one full batch in reserve.
+template <std::size_t Size, std::size_t Alignment>
+class block_cache {
+  public:
+    using pool_type = block_pool<Size, Alignment>;
+
+    static block_cache& instance()
+    {
+        static thread_local block_cache cache{};
+        return cache;
+    }
+
+    block_cache(block_cache const&) = delete;
+    block_cache& operator=(block_cache const&) = delete;
+
+    ~block_cache() noexcept
+    {
+        pool_.give_batch(current_);
+        pool_.give_batch(spare_);
+    }
+
+    void* allocate()
+    {
+        if (current_.size == 0) {
+            current_ = spare_.size != 0 ? std::exchange(spare_, {}) : pool_.take_batch();
+        }
+        auto* const block{current_.head};
+        current_.head = block->next;
+        --current_.size;
+        return block;
+    }
+
+    void deallocate(void* p) noexcept
+    {
+        current_.head = ::new (p) free_block{current_.head};
+        if (++current_.size == pool_type::batch_size) {
+            if (spare_.size != 0) {
+                pool_.give_batch(spare_);
+            }
+            spare_ = std::exchange(current_, {});
+        }
+    }
+
+  private:
+    // the pool has to outlive every thread's cache
+    block_cache() : pool_{pool_type::instance()} {}
+
+    // --- member data
+    pool_type& pool_;
+    block_batch current_{};
+    block_batch spare_{};
+};
+
+} // namespace node_allocator_detail
+
+template <typename T>
+class node_allocator {
+  private:
+    // a function rather than a type alias - containers instantiate their node allocator
+    // before the node type is complete
+    static auto& cache()
+    {
+        return node_allocator_detail::block_cache<sizeof(T), alignof(T)>::instance();
+    }
+
+  public:
+    using value_type = T;
+
+    node_allocator() noexcept = default;
+    template <typename U>
+    node_allocator(node_allocator<U> const&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (n != 1) {
+            // arrays aren't what this allocator is for
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+        }
+        return static_cast<T*>(cache().allocate());
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (n != 1) {
+            ::operator delete(p, std::align_val_t{alignof(T)});
+            return;
+        }
+        cache().deallocate(p);
+    }
+
+    // all blocks of one size come from the same global pool - any instance can free them
+    template <typename U>
+    bool operator==(node_allocator<U> const&) const noexcept
+    {
+        return true;
+    }
+};
+
+#endif // NODE_ALLOCATOR_HPP_
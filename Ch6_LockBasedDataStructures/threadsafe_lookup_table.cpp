@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "threadsafe_lookup_table.hpp"
+
+int main()
+{
+    // writers fill the table while readers look keys up - the table grows underneath them
+    threadsafe_lookup_table<int, int> table{};
+    constexpr auto writer_count{2};
+    constexpr auto keys_per_writer{200000};
+    std::atomic_bool done{false};
+    std::atomic<long> mismatches{0};
+
+    std::vector<std::thread> threads{};
+    for (auto w{0}; w != writer_count; ++w) {
+        threads.emplace_back([&table, w] {
+            for (auto i{w}; i < writer_count * keys_per_writer; i += writer_count) {
+                table.add_or_update_mapping(i, 2 * i);
+            }
+        });
+    }
+    for (auto r{0}; r != 2; ++r) {
+        threads.emplace_back([&table, &done, &mismatches] {
+            std::minstd_rand rng{std::random_device{}()};
+            std::uniform_int_distribution<int> keys{0, writer_count * keys_per_writer - 1};
+            while (!done.load()) {
+                auto const key{keys(rng)};
+                auto const value{table.value_for(key, -1)};
+                if (value != -1 && value != 2 * key) {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto w{0}; w != writer_count; ++w) {
+        threads[static_cast<std::size_t>(w)].join();
+    }
+    done = true;
+    for (auto i{static_cast<std::size_t>(writer_count)}; i != threads.size(); ++i) {
+        threads[i].join();
+    }
+    std::cerr << "size: " << table.size() << ", buckets: " << table.bucket_count()
+              << ", wrong values seen: " << mismatches.load() << "\n";
+
+    for (auto i{0}; i < writer_count * keys_per_writer; i += 2) {
+        table.remove_mapping(i);
+    }
+    auto const map{table.get_map()};
+    std::cerr << "after removing the even keys: " << map.size() << " entries, first "
+              << map.begin()->first << " -> " << map.begin()->second << "\n";
+
+    // walk a table while a writer keeps splitting buckets underneath: keys that are there
+    // throughout must be seen exactly once
+    {
+        constexpr auto stable_keys{100000};
+        threadsafe_lookup_table<int, int> walked{};
+        for (auto i{0}; i != stable_keys; ++i) {
+            walked.add_or_update_mapping(i, i);
+        }
+        std::atomic_bool walking{true};
+        std::thread writer{[&walked, &walking] {
+            for (auto i{stable_keys}; walking.load(); ++i) {
+                walked.add_or_update_mapping(i, i);
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }};
+        std::vector<unsigned char> seen(stable_keys, 0);
+        long duplicates{0};
+        long others{0};
+        auto const buckets_before{walked.bucket_count()};
+        long visited{0};
+        walked.for_each([&](int key, int) {
+            // give the writer a chance to split buckets in the middle of the walk
+            if (++visited % 256 == 0) {
+                std::this_thread::yield();
+            }
+            if (key >= stable_keys) {
+                ++others;
+            }
+            else if (seen[static_cast<std::size_t>(key)]++ != 0) {
+                ++duplicates;
+            }
+        });
+        walking = false;
+        writer.join();
+        std::cerr << "walk while growing from " << buckets_before << " to "
+                  << walked.bucket_count() << " buckets: "
+                  << std::count(seen.begin(), seen.end(), 1) << " of " << stable_keys
+                  << " stable keys seen once, " << duplicates << " duplicates, " << others
+                  << " keys added meanwhile\n";
+    }
+
+    // lookup cost stays flat as the table grows
+    threadsafe_lookup_table<long, long> growing{};
+    long next_key{0};
+    for (long target{1000}; target <= 10'000'000; target *= 10) {
+        for (; next_key != target; ++next_key) {
+            growing.add_or_update_mapping(next_key * 7919, next_key);
+        }
+        constexpr long lookups{1'000'000};
+        long found{0};
+        auto const start{std::chrono::steady_clock::now()};
+        for (long i{0}; i != lookups; ++i) {
+            found += growing.value_for((i % target) * 7919, -1) >= 0;
+        }
+        auto const elapsed{std::chrono::steady_clock::now() - start};
+        std::cerr << std::setw(10) << target << " keys: " << std::setw(6) << std::fixed
+                  << std::setprecision(1)
+                  << std::chrono::duration<double, std::nano>{elapsed}.count() / lookups
+                  << " ns/lookup (" << found << " found)\n";
+    }
+}
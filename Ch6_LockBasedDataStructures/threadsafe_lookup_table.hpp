@@ -1,77 +1,197 @@
 #pragma once
 
 #include <algorithm>
-#include <list>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <utility>
 #include <vector>
 
+#include "epoch_reclaimer.hpp"
+
+// Concurrent hash map that grows by linear hashing.
+//
+// The table never rehashes as a whole: whenever the average bucket holds more than
+// max_load_factor entries, the next bucket in line (the split pointer) is split in two and a
+// single new bucket is appended. With n buckets and 2^k <= n < 2^(k+1), a key goes to bucket
+// hash mod 2^(k+1), or hash mod 2^k if that bucket doesn't exist yet. Every bucket records the
+// mask that applies to it, so an operation that picked its bucket just before that bucket was
+// split notices under the lock and starts over.
+//
+// Buckets live in segments that double in size and are never moved or freed while the table
+// is alive, so growing only ever allocates the next segment. A bucket is a flat vector of
+// (hash, key, value) entries that a lookup scans comparing the stored hashes first.
+//
+// Lookups don't take any lock. A bucket's entries (and its mask) are immutable once
+// published: writers serialise on a fixed set of lock stripes, build a modified copy of the
+// bucket and swap the bucket's pointer to it, retiring the old copy through the epoch
+// reclaimer. A reader only pins the epoch - a store to its own thread's slot - and loads the
+// pointer, so no shared cache line is ever written on the read path. Writes cost a copy of
+// one bucket, which holds only a handful of entries.
+
 template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class threadsafe_lookup_table {
   private:
-    class bucket_type {
-      public:
-        using bucket_value = std::pair<Key, Value>;
-        using bucket_data = std::list<bucket_value>;
-        using bucket_iterator = typename bucket_data::iterator;
-        using bucket_const_iterator = typename bucket_data::const_iterator;
-
-      private:
-        // --- member variables
-        bucket_data data;
-        mutable std::shared_mutex mutex;
-
-        bucket_iterator find_entry_for(Key const& key) const
+    struct entry {
+        std::size_t hash;
+        Key key;
+        Value value;
+    };
+
+    // never modified once it has been published
+    struct bucket_data {
+        // the bucket holds the keys for which (hash & mask) equals its index
+        std::size_t mask{0};
+        std::vector<entry> entries{};
+
+        template <typename Entries>
+        static auto find(Entries& entries, std::size_t hash, Key const& key)
         {
-            return std::find_if(data.begin(), data.end(),
-                                [this, &key](bucket_value const& item) { return item.first == key; });
+            return std::find_if(entries.begin(), entries.end(), [hash, &key](entry const& e) {
+                return e.hash == hash && e.key == key;
+            });
         }
+    };
 
-      public:
-        Value value_for(const Key& key, const Value& default_value) const
-        {
-            std::shared_lock<std::shared_mutex> lock{mutex};
-            bucket_iterator const found_entry{find_entry_for(key)};
-            if (found_entry == data.end()) {
-                return default_value;
-            }
-            return found_entry->second;
+    struct bucket_type {
+        std::atomic<bucket_data*> data{nullptr};
+    };
+
+    struct alignas(64) lock_stripe {
+        std::mutex mutex{};
+    };
+
+    static constexpr std::size_t max_segments{48};
+    static constexpr std::size_t stripe_count{256};
+    static constexpr std::size_t max_load_factor{4};
+
+    // --- member data
+    Hash hasher_{};
+    std::size_t const initial_buckets_;
+    std::array<std::unique_ptr<bucket_type[]>, max_segments> segments_{};
+    std::atomic<std::size_t> bucket_count_;
+    std::atomic<std::size_t> size_{0};
+    mutable std::array<lock_stripe, stripe_count> stripes_{};
+    std::mutex split_mutex_{};
+
+    // --- helper functions
+    // segment 0 holds the initial buckets, segment k > 0 the initial_buckets_ * 2^(k-1) after
+    // those of segment k-1
+    std::size_t segment_size(std::size_t segment) const noexcept
+    {
+        return segment == 0 ? initial_buckets_ : initial_buckets_ << (segment - 1);
+    }
+
+    std::size_t segment_of(std::size_t index) const noexcept
+    {
+        // bit_width(index / initial_buckets_)
+        return static_cast<std::size_t>(std::numeric_limits<std::size_t>::digits -
+                                        std::countl_zero(index / initial_buckets_));
+    }
+
+    bucket_type& bucket_at(std::size_t index) const noexcept
+    {
+        if (index < initial_buckets_) {
+            return segments_[0][index];
         }
+        auto const segment{segment_of(index)};
+        return segments_[segment][index - segment_size(segment)];
+    }
 
-        void add_or_update_mapping(Key const& key, Value const& value)
-        {
-            std::unique_lock<std::shared_mutex> lock{mutex};
-            const bucket_iterator found_entry{find_entry_for(key)};
-            if (found_entry == data.end()) {
-                data.push_back(bucket_value(key, value));
-            }
-            else {
-                found_entry->second = value;
+    static std::size_t bucket_index(std::size_t hash, std::size_t bucket_count) noexcept
+    {
+        auto const high{std::bit_ceil(bucket_count)};
+        auto const index{hash & (high - 1)};
+        return index < bucket_count ? index : hash & (high / 2 - 1);
+    }
+
+    std::mutex& stripe_for(std::size_t index) const noexcept
+    {
+        return stripes_[index % stripe_count].mutex;
+    }
+
+    // The current entries of the bucket for `hash`. The caller must be pinned (or hold the
+    // bucket's stripe) for as long as it uses them.
+    bucket_data const& find_bucket(std::size_t hash) const noexcept
+    {
+        for (;;) {
+            auto const index{bucket_index(hash, bucket_count_.load(std::memory_order_acquire))};
+            auto const* const data{bucket_at(index).data.load(std::memory_order_acquire)};
+            // the bucket may have been split since we read the bucket count
+            if ((hash & data->mask) == index) {
+                return *data;
             }
         }
+    }
 
-        void remove_mapping(const Key& key)
-        {
-            std::unique_lock<std::shared_mutex> lock{mutex};
-            const bucket_iterator found_entry{find_entry_for(key)};
-            if (found_entry != data.end()) {
-                data.erase(found_entry);
+    // Calls f with the bucket for `hash` and its current entries, holding the bucket's stripe.
+    // f returns the bucket's new entries, or nullptr to leave it unchanged.
+    template <typename Function>
+    void update_bucket(std::size_t hash, Function&& f)
+    {
+        for (;;) {
+            auto const index{bucket_index(hash, bucket_count_.load(std::memory_order_acquire))};
+            std::lock_guard<std::mutex> lock{stripe_for(index)};
+            auto& bucket{bucket_at(index)};
+            auto* const old_data{bucket.data.load(std::memory_order_relaxed)};
+            if ((hash & old_data->mask) != index) {
+                continue;
             }
+            if (auto* const new_data{f(static_cast<bucket_data const&>(*old_data))}) {
+                bucket.data.store(new_data, std::memory_order_release);
+                // readers may still be looking at the old entries
+                epoch_reclaimer::retire(old_data);
+            }
+            return;
         }
-    }; // bucket_type
-
-    // --- member data
-    std::vector<std::unique_ptr<bucket_type>> buckets{19};
-    Hash hasher{};
+    }
 
-    // --- helper functions
-    bucket_type& get_bucket(const Key& key) const
+    // Splits the bucket at the split pointer, unless another thread is already splitting.
+    void try_split()
     {
-        const std::size_t bucket_index{hasher(key) % buckets.size()};
-        return *buckets[bucket_index];
+        std::unique_lock<std::mutex> split_lock{split_mutex_, std::try_to_lock};
+        if (!split_lock.owns_lock()) {
+            return;
+        }
+        auto const count{bucket_count_.load(std::memory_order_relaxed)};
+        if (size_.load(std::memory_order_relaxed) <= count * max_load_factor) {
+            return;
+        }
+        auto const segment{segment_of(count)};
+        if (segment == max_segments) {
+            return;
+        }
+        if (!segments_[segment]) {
+            segments_[segment] = std::make_unique<bucket_type[]>(segment_size(segment));
+        }
+
+        auto const half{std::bit_floor(count)};
+        auto const source_index{count - half};
+        auto const mask{2 * half - 1};
+        std::lock_guard<std::mutex> lock{stripe_for(source_index)};
+        auto& source{bucket_at(source_index)};
+        auto* const old_data{source.data.load(std::memory_order_relaxed)};
+        auto new_source{std::make_unique<bucket_data>(bucket_data{mask, {}})};
+        auto new_target{std::make_unique<bucket_data>(bucket_data{mask, {}})};
+        for (auto const& e : old_data->entries) {
+            ((e.hash & mask) == source_index ? new_source : new_target)->entries.push_back(e);
+        }
+        // The source bucket has to be replaced before the bucket count is published: a writer
+        // that sees the new count changes the new bucket under its own stripe, not the source's,
+        // and a reader must not find the key's old value in the old source entries after that.
+        // In between, operations on the moved keys that still use the old count see the new
+        // mask and start over until the new count shows up.
+        bucket_at(count).data.store(new_target.release(), std::memory_order_relaxed);
+        source.data.store(new_source.release(), std::memory_order_release);
+        bucket_count_.store(count + 1, std::memory_order_release);
+        epoch_reclaimer::retire(old_data);
     }
 
   public:
@@ -79,43 +199,142 @@ class threadsafe_lookup_table {
     using mapped_type = Value;
     using hash_type = Hash;
 
-    threadsafe_lookup_table() = default;
-    threadsafe_lookup_table(unsigned num_buckets, const Hash& hasher_)
-        : buckets{num_buckets}, hasher{hasher_}
+    static constexpr std::size_t default_bucket_count{16};
+
+    // the initial bucket count is rounded up to a power of two
+    explicit threadsafe_lookup_table(std::size_t num_buckets = default_bucket_count,
+                                     Hash const& hasher = Hash{})
+        : hasher_{hasher}
+        , initial_buckets_{std::bit_ceil(std::max(num_buckets, std::size_t{2}))}
+        , bucket_count_{initial_buckets_}
     {
-        for (unsigned i = 0; i < num_buckets; ++i) {
-            buckets[i].reset(std::make_unique<bucket_type>());
+        segments_[0] = std::make_unique<bucket_type[]>(initial_buckets_);
+        for (std::size_t i{0}; i != initial_buckets_; ++i) {
+            segments_[0][i].data.store(new bucket_data{initial_buckets_ - 1, {}},
+                                       std::memory_order_relaxed);
         }
     }
 
     threadsafe_lookup_table(const threadsafe_lookup_table&) = delete;
     threadsafe_lookup_table& operator=(const threadsafe_lookup_table&) = delete;
 
+    ~threadsafe_lookup_table() noexcept
+    {
+        // no other thread may access the table anymore - retired entries are the reclaimer's
+        auto const count{bucket_count_.load(std::memory_order_relaxed)};
+        for (std::size_t i{0}; i != count; ++i) {
+            delete bucket_at(i).data.load(std::memory_order_relaxed);
+        }
+    }
+
     Value value_for(const Key& key, const Value& default_value = Value{}) const
     {
-        return get_bucket(key).value_for(key, default_value);
+        auto const hash{hasher_(key)};
+        epoch_guard guard{};
+        auto const& bucket{find_bucket(hash)};
+        auto const found{bucket_data::find(bucket.entries, hash, key)};
+        return found == bucket.entries.end() ? default_value : found->value;
     }
 
     void add_or_update_mapping(const Key& key, const Value& value)
     {
-        get_bucket(key).add_or_update_mapping(key, value);
+        auto const hash{hasher_(key)};
+        auto added{false};
+        update_bucket(hash, [hash, &key, &value, &added](bucket_data const& old_data) {
+            auto new_data{std::make_unique<bucket_data>(old_data)};
+            auto const found{bucket_data::find(new_data->entries, hash, key)};
+            if (found != new_data->entries.end()) {
+                found->value = value;
+            }
+            else {
+                new_data->entries.push_back(entry{hash, key, value});
+                added = true;
+            }
+            return new_data.release();
+        });
+        if (added &&
+            size_.fetch_add(1, std::memory_order_relaxed) + 1 >
+                bucket_count_.load(std::memory_order_relaxed) * max_load_factor) {
+            try_split();
+        }
     }
 
-    void remove_mapping(const Key& key) { get_bucket(key).remove_mapping(key); }
-
-    std::map<Key, Value> get_map() const
+    void remove_mapping(const Key& key)
     {
-        std::vector<std::unique_lock<std::shared_mutex>> locks;
-        for (unsigned i = 0; i < buckets.size(); ++i) {
-            locks.push_back(std::unique_lock<std::shared_mutex>(buckets[i].mutex));
+        auto const hash{hasher_(key)};
+        auto removed{false};
+        update_bucket(hash, [hash, &key, &removed](bucket_data const& old_data) {
+            auto const found{bucket_data::find(old_data.entries, hash, key)};
+            if (found == old_data.entries.end()) {
+                return static_cast<bucket_data*>(nullptr);
+            }
+            auto* const new_data{new bucket_data{old_data.mask, {}}};
+            new_data->entries.reserve(old_data.entries.size() - 1);
+            std::copy(old_data.entries.begin(), found, std::back_inserter(new_data->entries));
+            std::copy(std::next(found), old_data.entries.end(),
+                      std::back_inserter(new_data->entries));
+            removed = true;
+            return new_data;
+        });
+        if (removed) {
+            size_.fetch_sub(1, std::memory_order_relaxed);
         }
+    }
 
-        std::map<Key, Value> res;
-        for (unsigned i = 0; i < buckets.size(); ++i) {
-            for (auto it = buckets[i].data.begin(); it != buckets[i].data.end(); ++it) {
-                res.insert(*it);
+    std::size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+    std::size_t bucket_count() const noexcept
+    {
+        return bucket_count_.load(std::memory_order_relaxed);
+    }
+
+    // Calls f(key, value) for every entry, one bucket at a time, without taking any lock.
+    //
+    // The view is weakly consistent: every key that is in the table for the whole walk is
+    // visited exactly once, with a value it had at some point during the walk; keys added or
+    // removed concurrently may or may not be visited. Each bucket is seen as one consistent
+    // version. The epoch is pinned for a single bucket at a time, so a long walk doesn't hold
+    // up reclamation either.
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        // Buckets are visited in index order. Splits move keys from a bucket to a new one at
+        // the end, so a new bucket's keys have been visited already iff its source bucket was
+        // visited before the split that created it - which its mask at that time tells.
+        // Per bucket visited: bit_width of its mask then, 0 if its keys were skipped.
+        std::vector<unsigned char> visited_levels{};
+        // A split publishes the bucket count only after the source bucket, so a source bucket
+        // may show its new mask before the count includes its new bucket - which has to be
+        // visited all the same.
+        std::size_t end{0};
+        for (std::size_t index{0};
+             index < std::max(end, bucket_count_.load(std::memory_order_acquire)); ++index) {
+            auto emit{true};
+            if (index >= initial_buckets_) {
+                auto const half{std::bit_floor(index)};
+                auto const source_level{visited_levels[index - half]};
+                emit = source_level > std::countr_zero(half);
+            }
+            epoch_guard guard{};
+            auto const* const data{bucket_at(index).data.load(std::memory_order_acquire)};
+            visited_levels.push_back(
+                emit ? static_cast<unsigned char>(std::bit_width(data->mask)) : 0);
+            if (auto const high{(data->mask + 1) / 2}; index < high) {
+                end = std::max(end, index + high + 1);
+            }
+            if (emit) {
+                for (auto const& e : data->entries) {
+                    f(e.key, e.value);
+                }
             }
         }
+    }
+
+    // weakly consistent, see for_each()
+    std::map<Key, Value> get_map() const
+    {
+        std::map<Key, Value> res;
+        for_each([&res](Key const& key, Value const& value) { res.emplace(key, value); });
         return res;
     }
 };
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "threadsafe_skip_list.hpp"
+
+// A time-series index: writers append samples under increasing timestamps (interleaved
+// between the writers) while readers look up single samples and read time ranges.
+
+int main()
+{
+    constexpr long samples_per_writer{200000};
+    constexpr auto range_length{100};
+    auto const thread_count{std::max(std::thread::hardware_concurrency(), 4u)};
+    auto const writer_count{thread_count / 2};
+    auto const total_samples{samples_per_writer * writer_count};
+
+    threadsafe_skip_list<long, double> index{};
+    std::atomic_bool done{false};
+    std::atomic<long> lookups{0};
+    std::atomic<long> ranges{0};
+    std::atomic<long> unordered_ranges{0};
+    std::vector<std::thread> threads{};
+
+    auto const start{std::chrono::steady_clock::now()};
+    for (auto w{0u}; w != writer_count; ++w) {
+        threads.emplace_back([&index, w, writer_count] {
+            for (long i{0}; i != samples_per_writer; ++i) {
+                auto const timestamp{i * writer_count + w};
+                index.add_or_update_mapping(timestamp, static_cast<double>(timestamp) / 2);
+            }
+        });
+    }
+    for (auto r{writer_count}; r != thread_count; ++r) {
+        threads.emplace_back([&, r] {
+            std::minstd_rand rng{r};
+            long local_lookups{0};
+            long local_ranges{0};
+            while (!done.load(std::memory_order_relaxed)) {
+                auto const at{static_cast<long>(rng() % static_cast<unsigned long>(total_samples))};
+                local_lookups += index.value_for(at, -1.0) >= 0;
+                long previous{-1};
+                index.for_each_in_range(at, at + range_length, [&](long timestamp, double) {
+                    unordered_ranges += timestamp <= previous;
+                    previous = timestamp;
+                });
+                ++local_ranges;
+                if (local_ranges % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            lookups += local_lookups;
+            ranges += local_ranges;
+        });
+    }
+    for (auto w{0u}; w != writer_count; ++w) {
+        threads[w].join();
+    }
+    auto const insert_time{std::chrono::duration<double>{std::chrono::steady_clock::now() - start}};
+    done = true;
+    for (auto r{writer_count}; r != thread_count; ++r) {
+        threads[r].join();
+    }
+
+    std::cerr << std::fixed << std::setprecision(2) << writer_count << " writers: "
+              << static_cast<double>(total_samples) / insert_time.count() / 1e6
+              << " M inserts/s, meanwhile " << ranges.load() << " range reads ("
+              << unordered_ranges.load() << " out of order) and " << lookups.load()
+              << " successful lookups\n";
+
+    // take out every other sample, then check what's left
+    for (long t{0}; t < total_samples; t += 2) {
+        index.remove_mapping(t);
+    }
+    long count{0};
+    long previous{-1};
+    bool ordered{true};
+    index.for_each([&](long timestamp, double value) {
+        ordered = ordered && timestamp > previous && value == static_cast<double>(timestamp) / 2;
+        previous = timestamp;
+        ++count;
+    });
+    auto const first{index.lower_bound(1000)};
+    std::cerr << "after removing the even timestamps: size " << index.size() << ", " << count
+              << " entries in order: " << std::boolalpha << ordered << ", first at or after 1000: "
+              << first->first << " -> " << first->second << "\n";
+}
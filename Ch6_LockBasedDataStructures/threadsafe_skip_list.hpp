@@ -0,0 +1,388 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+
+#include "epoch_reclaimer.hpp"
+
+// Concurrent ordered map: a lazy skip list (Herlihy, Lev, Luchangco and Shavit).
+//
+// Every node sits on level 0 and, with probability 1/4 per level, on the levels above, so a
+// search skips ahead on the sparse upper levels and descends - O(log n) steps without any
+// rebalancing. Writers lock optimistically: they search without locks, then lock just the
+// predecessors they are going to change and check that those are still unmarked and still
+// point to the expected successors, starting over if not. A node is only `fully_linked` once it
+// is on all of its levels, and removal first sets `marked` under the node's lock, so a node's
+// key is in the map exactly while it is fully linked and not marked.
+//
+// Readers don't take any lock: they pin the epoch and follow the links. Unlinked nodes are
+// retired through the epoch reclaimer, and so are the values replaced by updates - a node's
+// value is published through a pointer, so a reader always copies a complete value.
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class threadsafe_skip_list {
+  private:
+    static constexpr int max_level{16};
+
+    struct node;
+
+    struct node_base {
+        // top_level + 1 links, one per level the node is on
+        std::atomic<node*>* const next;
+        int const top_level;
+        std::mutex mutex{};
+        std::atomic<bool> marked{false};
+        std::atomic<bool> fully_linked{false};
+
+        node_base(std::atomic<node*>* links, int top) : next{links}, top_level{top} {}
+    };
+
+    // allocated together with its links, see create()
+    struct node : node_base {
+        Key const key;
+        Value const initial_value;
+        // initial_value, or the latest value assigned
+        std::atomic<Value const*> value{&initial_value};
+
+        node(std::atomic<node*>* links, int top, Key const& k, Value const& v)
+            : node_base{links, top}, key{k}, initial_value{v}
+        {
+        }
+
+        node(node const&) = delete;
+        node& operator=(node const&) = delete;
+
+        ~node() noexcept
+        {
+            if (auto const* const v{value.load(std::memory_order_relaxed)}; v != &initial_value) {
+                delete v;
+            }
+        }
+
+        static node* create(int top, Key const& key, Value const& value)
+        {
+            auto* const memory{static_cast<unsigned char*>(
+                ::operator new(sizeof(node) + static_cast<std::size_t>(top + 1) *
+                                                  sizeof(std::atomic<node*>)))};
+            auto* const links{reinterpret_cast<std::atomic<node*>*>(memory + sizeof(node))};
+            for (auto level{0}; level <= top; ++level) {
+                ::new (links + level) std::atomic<node*>{nullptr};
+            }
+            try {
+                return ::new (memory) node{links, top, key, value};
+            }
+            catch (...) {
+                ::operator delete(memory);
+                throw;
+            }
+        }
+
+        // delete has to free what create() allocated, whatever its size
+        static void operator delete(void* p) noexcept { ::operator delete(p); }
+    };
+
+    using preds_type = std::array<node_base*, max_level>;
+    using succs_type = std::array<node*, max_level>;
+
+    // --- member data
+    Compare less_{};
+    std::array<std::atomic<node*>, max_level> head_links_{};
+    node_base head_{head_links_.data(), max_level - 1};
+    std::atomic<std::size_t> size_{0};
+
+    // --- helper functions
+    // each level above 0 with probability 1/4
+    static int random_level()
+    {
+        static thread_local std::minstd_rand rng{std::random_device{}()};
+        auto const bits{static_cast<unsigned>(rng()) | (1u << (2 * (max_level - 1)))};
+        return std::countr_zero(bits) / 2;
+    }
+
+    // Fills in the predecessor and successor of key on every level and returns the highest
+    // level a node with that key was found on, or -1. The caller must be pinned.
+    int find(Key const& key, preds_type& preds, succs_type& succs)
+    {
+        auto found{-1};
+        node_base* pred{&head_};
+        for (auto level{max_level - 1}; level >= 0; --level) {
+            auto* cur{pred->next[level].load(std::memory_order_acquire)};
+            while (cur != nullptr && less_(cur->key, key)) {
+                pred = cur;
+                cur = pred->next[level].load(std::memory_order_acquire);
+            }
+            if (found == -1 && cur != nullptr && !less_(key, cur->key)) {
+                found = level;
+            }
+            preds[static_cast<std::size_t>(level)] = pred;
+            succs[static_cast<std::size_t>(level)] = cur;
+        }
+        return found;
+    }
+
+    // The first node whose key isn't less than key, dead or alive. The caller must be pinned.
+    node const* lower_bound_node(Key const& key) const
+    {
+        node_base const* pred{&head_};
+        node const* cur{nullptr};
+        for (auto level{max_level - 1}; level >= 0; --level) {
+            cur = pred->next[level].load(std::memory_order_acquire);
+            while (cur != nullptr && less_(cur->key, key)) {
+                pred = cur;
+                cur = pred->next[level].load(std::memory_order_acquire);
+            }
+        }
+        return cur;
+    }
+
+    static bool is_live(node const* n)
+    {
+        return n->fully_linked.load(std::memory_order_acquire) &&
+               !n->marked.load(std::memory_order_acquire);
+    }
+
+    // Locks the distinct predecessors on levels 0..top and checks that nobody has changed them
+    // since find(): still in the map and still followed by succs - or by `removed`, which the
+    // caller has marked itself.
+    bool lock_and_validate(preds_type const& preds, succs_type const& succs, int top,
+                           std::array<std::unique_lock<std::mutex>, max_level>& locks,
+                           node const* removed = nullptr)
+    {
+        node_base const* previous{nullptr};
+        for (auto level{0}; level <= top; ++level) {
+            auto const l{static_cast<std::size_t>(level)};
+            auto* const pred{preds[l]};
+            if (pred != previous) {
+                locks[l] = std::unique_lock<std::mutex>{pred->mutex};
+                previous = pred;
+            }
+            auto* const succ{removed ? removed : succs[l]};
+            if (pred->marked.load(std::memory_order_relaxed) ||
+                (removed == nullptr && succ != nullptr &&
+                 succ->marked.load(std::memory_order_relaxed)) ||
+                pred->next[level].load(std::memory_order_relaxed) != succ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Calls f(key, value) for the live entries from `from` (the start if null) up to but not
+    // including `to` (the end if null), unpinning every so often. A long scan thus doesn't
+    // hold up reclamation; it resumes after the last key visited.
+    template <typename Function>
+    void scan(Key const* from, Key const* to, Function& f) const
+    {
+        constexpr auto nodes_per_pin{256};
+        std::optional<Key> last{};
+        for (;;) {
+            epoch_guard guard{};
+            node const* cur{};
+            if (last) {
+                cur = lower_bound_node(*last);
+                // skip the last key visited - or a node that has replaced it
+                while (cur != nullptr && !less_(*last, cur->key)) {
+                    cur = cur->next[0].load(std::memory_order_acquire);
+                }
+            }
+            else {
+                cur = from ? lower_bound_node(*from)
+                           : head_.next[0].load(std::memory_order_acquire);
+            }
+            for (auto visited{0}; cur != nullptr;
+                 cur = cur->next[0].load(std::memory_order_acquire)) {
+                if (to != nullptr && !less_(cur->key, *to)) {
+                    return;
+                }
+                if (!is_live(cur)) {
+                    continue;
+                }
+                f(cur->key, *cur->value.load(std::memory_order_acquire));
+                if (++visited == nodes_per_pin) {
+                    break;
+                }
+            }
+            if (cur == nullptr) {
+                return;
+            }
+            last.emplace(cur->key);
+        }
+    }
+
+  public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    threadsafe_skip_list() = default;
+    explicit threadsafe_skip_list(Compare const& less) : less_{less} {}
+
+    threadsafe_skip_list(threadsafe_skip_list const&) = delete;
+    threadsafe_skip_list& operator=(threadsafe_skip_list const&) = delete;
+
+    ~threadsafe_skip_list() noexcept
+    {
+        // no other thread may access the list anymore - unlinked nodes are the reclaimer's
+        auto* p{head_.next[0].load(std::memory_order_relaxed)};
+        while (p) {
+            delete std::exchange(p, p->next[0].load(std::memory_order_relaxed));
+        }
+    }
+
+    Value value_for(Key const& key, Value const& default_value = Value{}) const
+    {
+        epoch_guard guard{};
+        auto const* const n{lower_bound_node(key)};
+        if (n == nullptr || less_(key, n->key) || !is_live(n)) {
+            return default_value;
+        }
+        return *n->value.load(std::memory_order_acquire);
+    }
+
+    void add_or_update_mapping(Key const& key, Value const& value)
+    {
+        auto const top{random_level()};
+        preds_type preds{};
+        succs_type succs{};
+        epoch_guard guard{};
+        for (;;) {
+            auto const found{find(key, preds, succs)};
+            if (found != -1) {
+                auto* const n{succs[static_cast<std::size_t>(found)]};
+                if (n->marked.load(std::memory_order_acquire)) {
+                    // on its way out - try again once it's gone
+                    std::this_thread::yield();
+                    continue;
+                }
+                // it's not in the map before it's fully linked - and we mustn't return before
+                while (!n->fully_linked.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                std::lock_guard<std::mutex> lock{n->mutex};
+                if (n->marked.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                auto* const old_value{
+                    n->value.exchange(new Value(value), std::memory_order_acq_rel)};
+                if (old_value != &n->initial_value) {
+                    // readers may still be copying it
+                    epoch_reclaimer::retire(const_cast<Value*>(old_value));
+                }
+                return;
+            }
+
+            std::array<std::unique_lock<std::mutex>, max_level> locks{};
+            if (!lock_and_validate(preds, succs, top, locks)) {
+                continue;
+            }
+            auto* const n{node::create(top, key, value)};
+            for (auto level{0}; level <= top; ++level) {
+                n->next[level].store(succs[static_cast<std::size_t>(level)],
+                                     std::memory_order_relaxed);
+            }
+            // bottom up, so that a node reachable on some level is reachable on all below
+            for (auto level{0}; level <= top; ++level) {
+                preds[static_cast<std::size_t>(level)]->next[level].store(
+                    n, std::memory_order_release);
+            }
+            n->fully_linked.store(true, std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    void remove_mapping(Key const& key)
+    {
+        preds_type preds{};
+        succs_type succs{};
+        epoch_guard guard{};
+        node* victim{nullptr};
+        std::unique_lock<std::mutex> victim_lock{};
+        for (;;) {
+            auto const found{find(key, preds, succs)};
+            if (victim == nullptr) {
+                if (found == -1) {
+                    return;
+                }
+                auto* const n{succs[static_cast<std::size_t>(found)]};
+                // a node that is only half linked or being removed isn't in the map; a node
+                // found below its top level is still being linked
+                if (!n->fully_linked.load(std::memory_order_acquire) || n->top_level != found ||
+                    n->marked.load(std::memory_order_acquire)) {
+                    return;
+                }
+                victim_lock = std::unique_lock<std::mutex>{n->mutex};
+                if (n->marked.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                // the logical removal - from here on the key isn't in the map
+                n->marked.store(true, std::memory_order_release);
+                victim = n;
+            }
+
+            std::array<std::unique_lock<std::mutex>, max_level> locks{};
+            if (!lock_and_validate(preds, succs, victim->top_level, locks, victim)) {
+                continue;
+            }
+            for (auto level{victim->top_level}; level >= 0; --level) {
+                preds[static_cast<std::size_t>(level)]->next[level].store(
+                    victim->next[level].load(std::memory_order_relaxed),
+                    std::memory_order_release);
+            }
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            victim_lock.unlock();
+            // readers may still be standing on it
+            epoch_reclaimer::retire(victim);
+            return;
+        }
+    }
+
+    // the entry with the smallest key not less than key
+    std::optional<std::pair<Key, Value>> lower_bound(Key const& key) const
+    {
+        epoch_guard guard{};
+        for (auto const* n{lower_bound_node(key)}; n != nullptr;
+             n = n->next[0].load(std::memory_order_acquire)) {
+            if (is_live(n)) {
+                return std::pair<Key, Value>{n->key, *n->value.load(std::memory_order_acquire)};
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Calls f(key, value) for the entries in ascending key order, without taking any lock.
+    // Weakly consistent: entries that are in the map for the whole scan are visited exactly
+    // once, with a value they had at some point; concurrent changes may or may not be seen.
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        scan(nullptr, nullptr, f);
+    }
+
+    // As for_each(), for the keys in [from, to).
+    template <typename Function>
+    void for_each_in_range(Key const& from, Key const& to, Function f) const
+    {
+        scan(&from, &to, f);
+    }
+
+    std::size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+    // weakly consistent, see for_each()
+    std::map<Key, Value, Compare> get_map() const
+    {
+        std::map<Key, Value, Compare> res{less_};
+        for_each([&res](Key const& key, Value const& value) { res.emplace(key, value); });
+        return res;
+    }
+};
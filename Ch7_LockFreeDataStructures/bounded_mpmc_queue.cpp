@@ -0,0 +1,56 @@
+#include "bounded_mpmc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+int main()
+{
+    // A deliberately small queue, so the producers keep running into a full queue and
+    // have to wait for the consumers.
+    bounded_mpmc_queue<long> queue{64};
+    constexpr long items_per_producer{200000};
+    constexpr auto producer_count{4};
+    constexpr auto consumer_count{4};
+    std::atomic<long> sum{0};
+
+    std::vector<std::thread> threads{};
+    for (auto p{0}; p != producer_count; ++p) {
+        threads.emplace_back([&queue]{
+            for (long i{1}; i <= items_per_producer; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+    for (auto c{0}; c != consumer_count; ++c) {
+        threads.emplace_back([&queue, &sum]{
+            long local_sum{0};
+            long value{0};
+            for (long i{0}; i != items_per_producer * producer_count / consumer_count; ++i) {
+                queue.wait_and_pop(value);
+                local_sum += value;
+            }
+            sum.fetch_add(local_sum);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cerr << "capacity: " << queue.capacity() << ", sum: " << sum.load() << " (expected "
+              << producer_count * items_per_producer * (items_per_producer + 1) / 2 << ")\n";
+
+    // the timed variants give up once the deadline has passed
+    for (long i{0}; queue.try_push(i); ++i)
+        ;
+    long value{-1};
+    auto const pushed = queue.push_until(value, std::chrono::steady_clock::now() +
+                                                    std::chrono::milliseconds{10});
+    std::cerr << "push into a full queue: " << std::boolalpha << pushed << "\n";
+    while (queue.try_pop(value))
+        ;
+    auto const popped = queue.wait_and_pop_until(value, std::chrono::steady_clock::now() +
+                                                            std::chrono::milliseconds{10});
+    std::cerr << "pop from an empty queue: " << popped << "\n";
+}
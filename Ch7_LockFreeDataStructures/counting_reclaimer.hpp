@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// The reclamation scheme of the first multi-consumer lock_free_stack, pulled out into a
+// reclaimer policy (see hazard_pointers.hpp for the interface).
+//
+// Every operation counts itself in with a guard. Retired nodes are chained onto a
+// to-be-deleted list, and whichever thread leaves while it's the only one inside deletes the
+// whole list. It's cheap, but if operations keep overlapping the count never drops to one
+// and nothing is ever reclaimed - memory use is unbounded under sustained contention.
+
+class counting_reclaimer {
+private:
+    struct retired_node {
+        void* pointer;
+        void (*deleter)(void*);
+        retired_node* next;
+    };
+
+    static inline std::atomic<unsigned> threads_in_op_{0};
+    static inline std::atomic<retired_node*> to_be_deleted_{nullptr};
+    static inline std::atomic<std::size_t> pending_{0};
+
+    static void delete_nodes(retired_node* nodes)
+    {
+        while (nodes)
+        {
+            retired_node* node = std::exchange(nodes, nodes->next);
+            node->deleter(node->pointer);
+            delete node;
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void try_reclaim()
+    {
+        if (threads_in_op_ == 1)
+        {
+            // take ownership of to-be-deleted nodes
+            retired_node* nodes_to_delete = to_be_deleted_.exchange(nullptr);
+            // check if we're still the only thread in an operation
+            if (!--threads_in_op_)
+            {
+                delete_nodes(nodes_to_delete);
+            }
+            // otherwise put the nodes to delete back in the delete queue
+            else if (nodes_to_delete)
+            {
+                chain_pending_nodes(nodes_to_delete);
+            }
+        }
+        else
+        {
+            --threads_in_op_;
+        }
+    }
+
+    static void chain_pending_nodes(retired_node* nodes)
+    {
+        // We need the first and last node
+        // of the to-delete-linked-list, if we want to
+        // add it to the queue
+        retired_node* last = nodes;
+        while (retired_node* const next = last->next)
+        {
+            last = next;
+        }
+        chain_pending_nodes(nodes, last);
+    }
+
+    static void chain_pending_nodes(retired_node* first, retired_node* last)
+    {
+        // push the pending_nodes to the front of the to-be-deleted queue
+        last->next = to_be_deleted_;
+        // make sure we see the changes any other threads may have made.
+        while (!to_be_deleted_.compare_exchange_weak(last->next, first))
+            ;
+    }
+
+    // convenience function for a single-node case
+    static void chain_pending_node(retired_node* n)
+    {
+        chain_pending_nodes(n, n);
+    }
+
+public:
+    class guard {
+    public:
+        guard() noexcept { ++threads_in_op_; }
+        guard(guard const&) = delete;
+        guard& operator=(guard const&) = delete;
+        ~guard() { try_reclaim(); }
+
+        // nothing can be deleted while any guard is alive, so a plain load is enough
+        template <typename T>
+        T* protect(std::atomic<T*> const& src) noexcept
+        {
+            return src.load();
+        }
+
+        template <typename T>
+        void set(T*) noexcept
+        {
+        }
+
+        void reset() noexcept {}
+    };
+
+    static constexpr bool guard_protects_all{true};
+
+    template <typename T>
+    static void retire(T* pointer)
+    {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        chain_pending_node(
+            new retired_node{pointer, [](void* p) { delete static_cast<T*>(p); }, nullptr});
+    }
+
+    static std::size_t pending_reclamation() noexcept
+    {
+        return pending_.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * Eventcount - lets threads sleep until "something changed" without a mutex on the notify path.
+ *
+ * A waiter announces itself with prepare_wait(), re-checks its condition and then either
+ * calls cancel_wait() (the condition became true in the meantime) or wait() with the key it got.
+ * A notifier first makes the condition true and then calls notify_one()/notify_all(). Any
+ * notification issued after prepare_wait() bumps the epoch, so the subsequent wait() returns
+ * immediately - no wake-ups get lost in between the check and the sleep.
+ * Notifying costs a fence and a load when nobody is sleeping.
+ */
+
+class event_count {
+public:
+    using key_type = std::uint32_t;
+
+    event_count() noexcept = default;
+    event_count(event_count const&) = delete;
+    event_count& operator=(event_count const&) = delete;
+
+    key_type prepare_wait() noexcept
+    {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        // the caller re-checks its condition next, possibly with relaxed loads
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    void cancel_wait() noexcept { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+    void wait(key_type key) noexcept
+    {
+        epoch_.wait(key, std::memory_order_acquire);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one() noexcept
+    {
+        if (has_waiters()) {
+            epoch_.fetch_add(1, std::memory_order_release);
+            epoch_.notify_one();
+        }
+    }
+
+    void notify_all() noexcept
+    {
+        if (has_waiters()) {
+            epoch_.fetch_add(1, std::memory_order_release);
+            epoch_.notify_all();
+        }
+    }
+
+private:
+    bool has_waiters() const noexcept
+    {
+        // pairs with the fetch_add in prepare_wait() - either the waiter sees the notifier's
+        // update to the condition, or the notifier sees the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters_.load(std::memory_order_relaxed) != 0;
+    }
+
+    // --- member data
+    std::atomic<key_type> epoch_{0};
+    std::atomic<key_type> waiters_{0};
+};
+
+/**
+ * Adaptive idle strategy for pool workers - yield for a bounded number of rounds, which keeps
+ * wake-up latency low when work arrives in bursts, then park on the eventcount.
+ */
+class spin_then_park {
+public:
+    static constexpr unsigned spin_limit{64u};
+
+    void reset() noexcept { spins_ = 0; }
+
+    // `ready` must return true when the worker should stop idling - work is available or
+    // the pool is shutting down.
+    template <typename Predicate>
+    void idle(event_count& event, Predicate ready)
+    {
+        if (spins_ < spin_limit) {
+            ++spins_;
+            std::this_thread::yield();
+            return;
+        }
+        auto const key{event.prepare_wait()};
+        if (ready()) {
+            event.cancel_wait();
+        }
+        else {
+            event.wait(key);
+        }
+        spins_ = 0;
+    }
+
+private:
+    unsigned spins_{0};
+};
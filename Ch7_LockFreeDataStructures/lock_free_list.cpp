@@ -0,0 +1,102 @@
+#include "counting_reclaimer.hpp"
+#include "epoch_reclaimer.hpp"
+#include "hazard_pointers.hpp"
+#include "lock_free_list.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writers insert and remove overlapping ranges of values while readers look values up and
+// walk the list - afterwards exactly the values that were left in must be there. Then the cost
+// of walking a 100k element list, which takes no lock at all.
+
+template<typename Reclaimer>
+void run(std::string const& name)
+{
+    constexpr auto writer_count{3};
+    constexpr auto range{2000};
+
+    lock_free_list<int, std::less<int>, Reclaimer> list{};
+    std::atomic_bool done{false};
+    std::atomic<long> unordered_walks{0};
+    std::vector<std::thread> threads{};
+    for (auto w{0}; w != writer_count; ++w) {
+        threads.emplace_back([&list, w] {
+            // every writer adds all values, then takes out its share of the odd ones
+            for (auto round{0}; round != 5; ++round) {
+                for (auto i{0}; i != range; ++i) {
+                    list.insert((i * 7 + w) % range);
+                }
+                for (auto i{2 * w + 1}; i < range; i += 2 * writer_count) {
+                    list.remove(i);
+                }
+            }
+        });
+    }
+    threads.emplace_back([&list, &done, &unordered_walks] {
+        while (!done.load()) {
+            int last{-1};
+            bool ordered{true};
+            list.for_each([&](int v) {
+                ordered = ordered && last < v;
+                last = v;
+            });
+            unordered_walks += !ordered;
+            for (auto i{0}; i < range; i += 97) {
+                list.contains(i);
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (auto w{0}; w != writer_count; ++w) {
+        threads[static_cast<std::size_t>(w)].join();
+    }
+    done = true;
+    threads.back().join();
+
+    long wrong{0};
+    for (auto i{0}; i != range; ++i) {
+        // the last round might have re-inserted an odd value after its remover's last pass
+        wrong += i % 2 == 0 && !list.contains(i);
+    }
+    long count{0};
+    list.for_each([&count](int) { ++count; });
+    std::cerr << name << ": " << count << " values left, even values missing: " << wrong
+              << ", walks out of order: " << unordered_walks.load()
+              << ", awaiting reclamation: " << Reclaimer::pending_reclamation() << "\n";
+}
+
+template<typename Reclaimer>
+void time_walk(std::string const& name)
+{
+    constexpr auto size{100000};
+    constexpr auto walks{20};
+    lock_free_list<int, std::less<int>, Reclaimer> list{};
+    // descending, so every insert is at the front
+    for (auto i{size}; i != 0; --i) {
+        list.insert(i);
+    }
+    long sum{0};
+    auto const start{std::chrono::steady_clock::now()};
+    for (auto w{0}; w != walks; ++w) {
+        list.for_each([&sum](int v) { sum += v; });
+    }
+    auto const elapsed{std::chrono::steady_clock::now() - start};
+    std::cerr << name << ": walking " << size << " elements takes "
+              << std::chrono::duration<double, std::milli>{elapsed}.count() / walks << "ms ("
+              << sum / walks << ")\n";
+}
+
+int main()
+{
+    run<hazard_pointer_reclaimer>("hazard pointers");
+    run<epoch_reclaimer>("epochs");
+    run<counting_reclaimer>("counting");
+
+    time_walk<hazard_pointer_reclaimer>("hazard pointers");
+    time_walk<epoch_reclaimer>("epochs");
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "epoch_reclaimer.hpp"
+#include "hazard_pointers.hpp"
+
+// Lock-free ordered set on a singly linked list (Harris, with Michael's reclamation-safe
+// traversal).
+//
+// Removal happens in two steps. First the node is deleted logically by setting the mark bit in
+// its own `next` pointer - from then on no compare-exchange on that pointer can succeed, so
+// nothing can be linked in after a node that is on its way out. Then it is unlinked with a
+// compare-exchange on its predecessor's `next`. If that fails, the next traversal that runs
+// into the marked node unlinks it instead, so no operation ever has to wait for another one.
+// The node is retired by whichever thread unlinked it.
+//
+// Traversals that may unlink nodes protect the current node and its predecessor with two
+// guards and check, after publishing a node, that the predecessor still points to it unmarked -
+// otherwise they start over. contains() and for_each() don't change anything: if the
+// Reclaimer's guard keeps everything alive (epoch_reclaimer, the default, or
+// counting_reclaimer), they follow the links straight through marked nodes and never restart,
+// so they are wait-free. With hazard pointers they have to validate like everyone else.
+
+template<typename T, typename Compare = std::less<T>, typename Reclaimer = epoch_reclaimer>
+class lock_free_list {
+private:
+    struct node {
+        T const value;
+        std::atomic<node*> next{nullptr};
+
+        template<typename... Args>
+        explicit node(Args&&... args) : value(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    static bool is_marked(node* p) noexcept { return reinterpret_cast<std::uintptr_t>(p) & 1u; }
+    static node* marked(node* p) noexcept
+    {
+        return reinterpret_cast<node*>(reinterpret_cast<std::uintptr_t>(p) | 1u);
+    }
+    static node* unmarked(node* p) noexcept
+    {
+        return reinterpret_cast<node*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{1});
+    }
+
+    // A position in the list: `cur` is the first unmarked node a search stopped at (or null at
+    // the end), `prev` the link that pointed to it. Both the node holding `prev` and `cur` are
+    // guarded.
+    struct cursor {
+        typename Reclaimer::guard guards[2]{};
+        unsigned cur_guard{0};
+        std::atomic<node*>* prev{nullptr};
+        node* cur{nullptr};
+
+        typename Reclaimer::guard& guard_for_cur() noexcept { return guards[cur_guard]; }
+        // the guard of the node we came from becomes free for the next one
+        void advance(node* next) noexcept
+        {
+            prev = &cur->next;
+            cur = next;
+            cur_guard ^= 1u;
+        }
+    };
+
+    // --- member data
+    Compare less_{};
+    // mutable: const traversals help unlinking removed nodes, too
+    mutable std::atomic<node*> head_{nullptr};
+
+    // Positions c at the first node for which stop(value) holds, starting at `start` - a link
+    // inside a node the caller keeps guarded - and from the head if that node gets removed.
+    // Unlinks the marked nodes it passes.
+    template<typename Stop>
+    void search(cursor& c, Stop const& stop, std::atomic<node*>* start) const
+    {
+    try_again:
+        c.prev = start;
+        c.cur = start->load(std::memory_order_acquire);
+        start = &head_;
+        if (is_marked(c.cur)) {
+            // the node holding start is gone, and the marked link would pass the check below
+            goto try_again;
+        }
+        for (;;) {
+            if (c.cur == nullptr) {
+                return;
+            }
+            // a marked prev link doesn't compare equal either: the node we came from is gone
+            c.guard_for_cur().set(c.cur);
+            if (c.prev->load(std::memory_order_acquire) != c.cur) {
+                goto try_again;
+            }
+            node* const next{c.cur->next.load(std::memory_order_acquire)};
+            if (is_marked(next)) {
+                // removed, but still linked - help unlinking it
+                auto expected{c.cur};
+                if (!c.prev->compare_exchange_strong(expected, unmarked(next),
+                                                     std::memory_order_acq_rel)) {
+                    goto try_again;
+                }
+                Reclaimer::retire(c.cur);
+                c.cur = unmarked(next);
+                continue;
+            }
+            if (stop(c.cur->value)) {
+                return;
+            }
+            c.advance(next);
+        }
+    }
+
+    // the first node not less than value
+    void lower_bound(cursor& c, T const& value) const
+    {
+        search(c, [this, &value](T const& v) { return !less_(v, value); }, &head_);
+    }
+
+    bool equal(T const& a, T const& b) const { return !less_(a, b) && !less_(b, a); }
+
+public:
+    using value_type = T;
+
+    lock_free_list() = default;
+    explicit lock_free_list(Compare const& less) : less_{less} {}
+
+    lock_free_list(lock_free_list const&) = delete;
+    lock_free_list& operator=(lock_free_list const&) = delete;
+
+    ~lock_free_list() noexcept
+    {
+        // no other thread may access the list anymore - unlinked nodes are the reclaimer's
+        auto* p{head_.load(std::memory_order_relaxed)};
+        while (p) {
+            delete std::exchange(p, unmarked(p->next.load(std::memory_order_relaxed)));
+        }
+    }
+
+    // Adds the value unless an equal one is in the list already.
+    template<typename... Args>
+    bool emplace(Args&&... args)
+    {
+        auto new_node{std::make_unique<node>(std::forward<Args>(args)...)};
+        cursor c{};
+        for (;;) {
+            lower_bound(c, new_node->value);
+            if (c.cur != nullptr && equal(c.cur->value, new_node->value)) {
+                return false;
+            }
+            new_node->next.store(c.cur, std::memory_order_relaxed);
+            auto expected{c.cur};
+            if (c.prev->compare_exchange_strong(expected, new_node.get(),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+                new_node.release();
+                return true;
+            }
+        }
+    }
+
+    bool insert(T const& value) { return emplace(value); }
+    bool insert(T&& value) { return emplace(std::move(value)); }
+
+    bool remove(T const& value)
+    {
+        cursor c{};
+        for (;;) {
+            lower_bound(c, value);
+            if (c.cur == nullptr || !equal(c.cur->value, value)) {
+                return false;
+            }
+            node* const next{c.cur->next.load(std::memory_order_acquire)};
+            if (is_marked(next)) {
+                // somebody else is removing it - see whether it's still there
+                continue;
+            }
+            // the logical removal - this is where remove() takes effect
+            auto expected{next};
+            if (!c.cur->next.compare_exchange_strong(expected, marked(next),
+                                                     std::memory_order_acq_rel)) {
+                continue;
+            }
+            expected = c.cur;
+            if (c.prev->compare_exchange_strong(expected, next, std::memory_order_acq_rel)) {
+                Reclaimer::retire(c.cur);
+            }
+            else {
+                // leave the unlinking to a search - this one
+                lower_bound(c, value);
+            }
+            return true;
+        }
+    }
+
+    bool contains(T const& value) const
+    {
+        if constexpr (Reclaimer::guard_protects_all) {
+            typename Reclaimer::guard guard{};
+            node* p{guard.protect(head_)};
+            while (p != nullptr && less_(p->value, value)) {
+                p = unmarked(p->next.load(std::memory_order_acquire));
+            }
+            return p != nullptr && !less_(value, p->value) &&
+                   !is_marked(p->next.load(std::memory_order_acquire));
+        }
+        else {
+            cursor c{};
+            lower_bound(c, value);
+            return c.cur != nullptr && equal(c.cur->value, value);
+        }
+    }
+
+    // Calls f(value) for the values in ascending order. Values that are in the list for the
+    // whole traversal are visited exactly once, concurrently added or removed ones may or may
+    // not be.
+    template<typename Function>
+    void for_each(Function f) const
+    {
+        if constexpr (Reclaimer::guard_protects_all) {
+            typename Reclaimer::guard guard{};
+            for (node* p{guard.protect(head_)}; p != nullptr;) {
+                node* const next{p->next.load(std::memory_order_acquire)};
+                if (!is_marked(next)) {
+                    f(p->value);
+                }
+                p = unmarked(next);
+            }
+        }
+        else {
+            cursor c{};
+            // the node visited last - where to resume if the cursor has to start over
+            typename Reclaimer::guard last_guard{};
+            search(c, [](T const&) { return true; }, &head_);
+            while (c.cur != nullptr) {
+                f(c.cur->value);
+                node const* const last{c.cur};
+                // already protected by the cursor
+                last_guard.set(last);
+                search(c, [this, last](T const& v) { return less_(last->value, v); },
+                       &c.cur->next);
+            }
+        }
+    }
+
+    bool empty() const
+    {
+        bool res{true};
+        for_each([&res](T const&) { res = false; });
+        return res;
+    }
+};
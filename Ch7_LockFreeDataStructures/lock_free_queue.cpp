@@ -0,0 +1,56 @@
+#include "counting_reclaimer.hpp"
+#include "epoch_reclaimer.hpp"
+#include "hazard_pointers.hpp"
+#include "lock_free_queue.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Several producers and consumers on one queue - every pushed value has to come out exactly
+// once, whichever reclaimer the queue uses.
+
+template<typename Reclaimer>
+void run(std::string const& name)
+{
+    constexpr long items_per_producer{100000};
+    constexpr auto producer_count{3};
+    constexpr auto consumer_count{3};
+
+    lock_free_queue<long, Reclaimer> queue{};
+    std::atomic<long> sum{0};
+    std::vector<std::thread> threads{};
+    for (auto p{0}; p != producer_count; ++p) {
+        threads.emplace_back([&queue]{
+            for (long i{1}; i <= items_per_producer; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+    for (auto c{0}; c != consumer_count; ++c) {
+        threads.emplace_back([&queue, &sum]{
+            long local_sum{0};
+            long value{0};
+            for (long i{0}; i != items_per_producer * producer_count / consumer_count; ++i) {
+                queue.wait_and_pop(value);
+                local_sum += value;
+            }
+            sum.fetch_add(local_sum);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cerr << name << ": sum " << sum.load() << " (expected "
+              << producer_count * items_per_producer * (items_per_producer + 1) / 2
+              << "), empty afterwards: " << std::boolalpha << queue.empty()
+              << ", awaiting reclamation: " << Reclaimer::pending_reclamation() << "\n";
+}
+
+int main()
+{
+    run<hazard_pointer_reclaimer>("hazard pointers");
+    run<epoch_reclaimer>("epoch");
+    run<counting_reclaimer>("counter");
+}
@@ -0,0 +1,49 @@
+#include "lock_free_stack.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+int main()
+{
+    lock_free_stack<int> stack{};
+    std::atomic_bool done{false};
+    std::atomic<long> popped{0};
+
+    auto const producer = [&stack, &done]{
+        for (auto i{0}; !done.load(); ++i) {
+            stack.push(i);
+        }
+    };
+    auto const consumer = [&stack, &done, &popped]{
+        while (!done.load()) {
+            if (stack.pop()) {
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads{};
+    for (auto i{0}; i != 2; ++i) {
+        threads.emplace_back(producer);
+        threads.emplace_back(consumer);
+        threads.emplace_back(consumer);
+    }
+
+    // Continuous multi-consumer load - the number of popped-but-not-yet-deleted nodes
+    // has to stay bounded the whole time.
+    auto const& domain = hazard_pointer_domain::instance();
+    for (auto i{0}; i != 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        std::cerr << "popped: " << popped.load()
+                  << ", awaiting reclamation: " << domain.pending_reclamation() << "\n";
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cerr << "after all threads exited, awaiting reclamation: "
+              << domain.pending_reclamation() << "\n";
+}
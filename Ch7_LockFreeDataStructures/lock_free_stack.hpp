@@ -4,13 +4,15 @@
 #include <utility>
 #include <type_traits>
 
+#include "hazard_pointers.hpp"
 
-template<typename T>
+
+template<typename T, typename Reclaimer = hazard_pointer_reclaimer>
 class lock_free_stack {
 private:
     struct node {
         std::shared_ptr<T> data;
-        node* next;
+        node* next{nullptr};
 
         node(T const& data_)
             : data{std::make_shared<T>(data_)}
@@ -27,143 +29,106 @@ private:
             : data{std::make_shared<T>(std::forward<Args>(args)...)}
         {
         }
-    };
 
-    std::atomic<node*> head_;
-    std::atomic<unsigned> threads_in_pop_{0};
-    std::atomic<node*> to_be_deleted_;
+        node(node const&) = delete;
+        node& operator=(node const&) = delete;
+    };
 
+    std::atomic<node*> head_{nullptr};
 
-    static void delete_nodes(node* nodes)
+    void push_node(node* const new_node)
     {
-        while (nodes)
-        {
-            // node* next = nodes->next;
-            // delete nodes;
-            // nodes = next;
-            node* node = std::exchange(nodes, nodes->next);
-            delete node;
-        }
+        new_node->next = head_.load();
+        // We update the head_ to point to the new_node, but only if
+        // head_ hasn't been modified by another thread since we've set
+        // new_node-next to it; compare_exchange_weak will update
+        // the new_node->next if it no longer points to head_,
+        // otherwise it will set head_ to new_node.
+        while (!head_.compare_exchange_weak(new_node->next, new_node))
+            ;
     }
 
-    void try_reclaim(node* old_head)
-    {
-        if (threads_in_pop_ == 1)
-        {
-            // take ownership of to-be-deleted nodes
-            node* nodes_to_delete = to_be_deleted_.exchange(nullptr);
-            // check if we're still the only thread in pop
-            if (!--threads_in_pop_)
-            {
-                delete_nodes(nodes_to_delete);
-            }
-            // otherwise put the nodes to delete back in the delete queue
-            else if (nodes_to_delete)
-            {
-                chain_pending_nodes(nodes_to_delete);
-            }
-            // If we got here it's always safe to delete the node
-            // we poped originally.
-            delete old_head;
-        }
-        else
-        {
-            chain_pending_node(old_head);
-            --threads_in_pop_;
-        }
-    }
+public:
+    lock_free_stack() = default;
+    lock_free_stack(lock_free_stack const&) = delete;
+    lock_free_stack& operator=(lock_free_stack const&) = delete;
 
-    void chain_pending_nodes(nodes* nodes)
+    ~lock_free_stack()
     {
-        // We need the first and last node
-        // of the to-delete-linked-list, if we want to
-        // add it to the queue
-        node* last = nodes;
-        while (node* const next = last->next)
+        // no other thread may access the stack anymore - no need to go through the reclaimer
+        node* nodes = head_.load();
+        while (nodes)
         {
-            last = next;
+            delete std::exchange(nodes, nodes->next);
         }
-        chain_pending_nodes(nodes, last);
     }
 
-    void chain_pending_nodes(node* first, node* last)
+    void push(T const& data)
     {
-        // push the pending_nodes to the front of the to-be-deleted queue
-        last->next = to_be_deleted_;
-        // make sure we see the changes any other threads may have made.
-        while (!to_be_deleted_.compare_exchange_weak(last->next, first))
-            ;
+        // allocation here can throw - we haven't mutated anything yet,
+        // so we're safe.
+        push_node(new node(data));
     }
 
-    // convenience function for a single-node case
-    void chain_pending_node(node* n)
+    void push(T&& data)
     {
-        chain_pending_nodes(n, n);
+        push_node(new node(std::move(data)));
     }
 
-public:
-    void push(T const& data)
+    template<typename... Args>
+    void emplace(Args&&... args)
     {
-        // allocation here can throw - we haven't mutated anything yet,
-        // so we're safe.
-        node* const new_node = new node(data);
-        new_node->next = head_.load();
-        // We update the head_ to point to the new_node, but only if
-        // head_ hasn't been modified by another thread since we've set
-        // new_node-next to it; compare_exchange_weak will update
-        // the new_node->next if it no longer points to head_,
-        // otherwise it will set head_ to new_node.
-        while (!head_.compare_exchange_weak(new_node->next, new_node))
-            ;
+        push_node(new node(std::in_place, std::forward<Args>(args)...));
     }
 
     std::shared_ptr<T> pop()
     {
-        node* old_head = head_.load();  // #1
+        // The node we read at #1 may be popped - and deleted - by another thread before we
+        // get to read its `next` pointer at #2. The reclaimer's guard makes sure that
+        // doesn't happen: the node stays alive until the guard is reset, and since it can't
+        // be reused in the meantime the compare-exchange isn't subject to the ABA problem.
+        typename Reclaimer::guard guard{};
+        node* old_head;
+        do
+        {
+            old_head = guard.protect(head_);  // #1
+        }
         while (old_head &&
-               !head_.compare_exchange_weak(old_head, old_head->next))  // #2
-            ;
-        return old_head ? old_head->data : {nullptr};
-        // !!! Note that we leak the node here! This is because if we deleted
-        // the node, but another thread just read it #1 and hasn't reached #2
-        // before we deleted the node, the other thread would then dereference
-        // a nullptr in step #2.
-        // TODO: how to handle this?
-        // - for a single consumer (only one thread calling pop()) this is
-        //   trivial - we could just delete the node here.
-        // - multiple-consumer implementations need to keep track of the
-        //   popped nodes - by pushing them to a `to-be-deleted` queue.
-        //   The nodes on the delete-queue can only be deleted when
-        //   there's no threads calling pop - this needs to be tracked
-        //   with an atomic counter.
+               !head_.compare_exchange_strong(old_head, old_head->next));  // #2
+        guard.reset();
+
+        std::shared_ptr<T> res;
+        if (old_head)
+        {
+            res.swap(old_head->data);
+            // we've unlinked the node, but other threads may still be looking at it -
+            // hand it to the reclaimer rather than deleting it here
+            Reclaimer::retire(old_head);
+        }
+        return res;
     }
 
     std::shared_ptr<T> single_consumer_pop()
     {
+        // for a single consumer (only one thread calling pop()) nobody else
+        // can be looking at the node, so it can be deleted right away.
         node* old_head = head_.load();  // #1
         while (old_head &&
                !head_.compare_exchange_weak(old_head, old_head->next))  // #2
             ;
 
-        auto val = old_head ? std::move(old_head->data) : {nullptr};
+        std::shared_ptr<T> val;
+        if (old_head)
+        {
+            val.swap(old_head->data);
+        }
         delete old_head;
         return val;
     }
 
-    std::shared_ptr<T> multi_consumer_pop()
+    bool empty() const noexcept
     {
-        ++threads_in_pop_;
-        node* old_head = head_.load();
-        while (old_head &&
-               !head_.compare_exchange_weak(old_head, old_head->next))
-            ;
-        std::shared_ptr<T> res;
-        if (old_head)
-        {
-            res.swap(old_head->data);
-        }
-        try_reclaim(old_head);
-        return res;
+        return head_.load() == nullptr;
     }
 
     /// Invalid implementation attempt - impossible to guarantee
@@ -179,6 +144,5 @@ public:
     //     // the node, but another thread just read it #1 and hasn't reached #2
     //     // before we deleted the node, the other thread would then dereference
     //     // a nullptr in step #2.
-    //     // TODO: how to handle this?
     // }
 };
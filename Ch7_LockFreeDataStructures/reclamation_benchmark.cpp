@@ -0,0 +1,94 @@
+#include "counting_reclaimer.hpp"
+#include "epoch_reclaimer.hpp"
+#include "hazard_pointers.hpp"
+#include "lock_free_stack.hpp"
+#include "split_ref_lock_free_stack.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput and peak number of retired-but-not-yet-deleted nodes of the same stack under the
+// different reclamation schemes. Every thread alternates push and pop, so all of them
+// contend on the head pointer and every pop retires a node.
+
+namespace
+{
+constexpr auto run_time = std::chrono::milliseconds{300};
+
+struct no_pending_nodes {
+    // split reference counting deletes a node as soon as the last reference to it is dropped
+    static std::size_t pending_reclamation() noexcept { return 0; }
+};
+
+template<typename Stack, typename Stats>
+void run_benchmark(std::string const& name, unsigned thread_count)
+{
+    Stack stack{};
+    for (auto i{0}; i != 1000; ++i) {
+        stack.push(i);
+    }
+
+    std::atomic_bool go{false};
+    std::atomic_bool done{false};
+    std::atomic<long> operations{0};
+    std::vector<std::thread> threads{};
+    for (auto t{0u}; t != thread_count; ++t) {
+        threads.emplace_back([&stack, &go, &done, &operations]{
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            long local_operations{0};
+            for (auto i{0}; !done.load(std::memory_order_relaxed); ++i) {
+                stack.push(i);
+                stack.pop();
+                local_operations += 2;
+            }
+            operations.fetch_add(local_operations);
+        });
+    }
+
+    std::size_t peak_pending{0};
+    go = true;
+    auto const start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < run_time) {
+        peak_pending = std::max(peak_pending, Stats::pending_reclamation());
+        std::this_thread::sleep_for(std::chrono::microseconds{200});
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const seconds = std::chrono::duration<double>{run_time}.count();
+
+    std::cerr << std::left << std::setw(24) << name
+              << std::right << std::setw(10) << thread_count
+              << std::setw(16) << std::fixed << std::setprecision(2)
+              << static_cast<double>(operations.load()) / seconds / 1e6
+              << std::setw(16) << peak_pending << "\n";
+}
+} // namespace
+
+
+int main()
+{
+    auto const max_threads = std::max(std::thread::hardware_concurrency(), 4u);
+    std::cerr << std::left << std::setw(24) << "reclamation"
+              << std::right << std::setw(10) << "threads"
+              << std::setw(16) << "Mops/s"
+              << std::setw(16) << "peak retired" << "\n";
+    for (auto threads{1u}; threads <= max_threads; threads *= 2) {
+        run_benchmark<lock_free_stack<int, counting_reclaimer>, counting_reclaimer>(
+            "counter", threads);
+        run_benchmark<split_ref_lock_free_stack<int>, no_pending_nodes>(
+            "split reference count", threads);
+        run_benchmark<lock_free_stack<int, hazard_pointer_reclaimer>, hazard_pointer_reclaimer>(
+            "hazard pointers", threads);
+        run_benchmark<lock_free_stack<int, epoch_reclaimer>, epoch_reclaimer>(
+            "epoch", threads);
+    }
+}
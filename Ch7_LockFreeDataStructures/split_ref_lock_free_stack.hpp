@@ -5,22 +5,25 @@
 #include <type_traits>
 
 
+// Reclaims nodes with split reference counts instead of a separate reclaimer - the last
+// thread to drop its reference deletes the node. std::atomic<counted_node_ptr> is two words
+// wide, so on gcc/clang it needs libatomic (which uses cmpxchg16b where available).
 template<typename T>
-class lock_free_stack {
+class split_ref_lock_free_stack {
 private:
     struct node;
 
     struct counted_node_ptr {
-        int external_count;
-        node* ptr;
+        int external_count{0};
+        node* ptr{nullptr};
     };
 
     struct node {
         std::shared_ptr<T> data;
         std::atomic<int> internal_count{0};
-        counted_node_ptr next;
+        counted_node_ptr next{};
 
-        node(T const& data)
+        node(T const& data_)
             : data{std::make_shared<T>(data_)}
         {
         }
@@ -32,7 +35,7 @@ private:
         }
     };
 
-    std::atomic<counted_node_ptr> head_;
+    std::atomic<counted_node_ptr> head_{counted_node_ptr{}};
 
     void increase_head_count(counted_node_ptr& old_counter)
     {
@@ -48,7 +51,11 @@ private:
     }
 
 public:
-    ~lock_free_stack()
+    split_ref_lock_free_stack() = default;
+    split_ref_lock_free_stack(split_ref_lock_free_stack const&) = delete;
+    split_ref_lock_free_stack& operator=(split_ref_lock_free_stack const&) = delete;
+
+    ~split_ref_lock_free_stack()
     {
         while(pop())
             ;
@@ -0,0 +1,127 @@
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+
+// Producer/consumer throughput of the SPSC ring with the single-element, the bulk and the
+// zero-copy interfaces. Whichever side finds the queue full or empty yields, so the benchmark
+// still makes progress if both threads end up sharing a core.
+
+namespace
+{
+constexpr long item_count{10'000'000};
+constexpr std::size_t batch_size{64};
+
+template<typename Producer, typename Consumer>
+void run_benchmark(std::string const& name, Producer produce, Consumer consume)
+{
+    spsc_queue<long> queue{4096};
+    long sum{0};
+    auto const start = std::chrono::steady_clock::now();
+    std::thread consumer{[&queue, &sum, &consume]{ sum = consume(queue); }};
+    produce(queue);
+    consumer.join();
+    auto const seconds =
+        std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+
+    std::cerr << std::left << std::setw(16) << name << std::right << std::setw(12)
+              << std::fixed << std::setprecision(2)
+              << static_cast<double>(item_count) / seconds / 1e6 << " Mops/s"
+              << (sum == item_count * (item_count - 1) / 2 ? "" : "  wrong sum!") << "\n";
+}
+} // namespace
+
+
+int main()
+{
+    run_benchmark(
+        "try_push/pop",
+        [](spsc_queue<long>& queue) {
+            for (long i{0}; i != item_count;) {
+                if (queue.try_push(i)) {
+                    ++i;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        },
+        [](spsc_queue<long>& queue) {
+            long sum{0};
+            long value{0};
+            for (long i{0}; i != item_count;) {
+                if (queue.try_pop(value)) {
+                    sum += value;
+                    ++i;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            return sum;
+        });
+
+    run_benchmark(
+        "push_n/pop_n",
+        [](spsc_queue<long>& queue) {
+            std::array<long, batch_size> batch{};
+            for (long i{0}; i != item_count;) {
+                auto const count = std::min(batch_size, static_cast<std::size_t>(item_count - i));
+                std::iota(batch.begin(), batch.begin() + static_cast<long>(count), i);
+                std::size_t pushed{0};
+                while ((pushed += queue.push_n(batch.begin() + static_cast<long>(pushed),
+                                               count - pushed)) != count) {
+                    std::this_thread::yield();
+                }
+                i += static_cast<long>(count);
+            }
+        },
+        [](spsc_queue<long>& queue) {
+            std::array<long, batch_size> batch{};
+            long sum{0};
+            for (long i{0}; i != item_count;) {
+                auto const popped = queue.pop_n(batch.begin(), batch_size);
+                if (popped == 0) {
+                    std::this_thread::yield();
+                }
+                sum = std::accumulate(batch.begin(), batch.begin() + static_cast<long>(popped),
+                                      sum);
+                i += static_cast<long>(popped);
+            }
+            return sum;
+        });
+
+    run_benchmark(
+        "reserve/peek",
+        [](spsc_queue<long>& queue) {
+            for (long i{0}; i != item_count;) {
+                auto const slots =
+                    queue.reserve(std::min(batch_size, static_cast<std::size_t>(item_count - i)));
+                for (auto& slot : slots) {
+                    slot = i++;
+                }
+                queue.commit(slots.size());
+                if (slots.empty()) {
+                    std::this_thread::yield();
+                }
+            }
+        },
+        [](spsc_queue<long>& queue) {
+            long sum{0};
+            for (long i{0}; i != item_count;) {
+                auto const items = queue.peek(batch_size);
+                sum = std::accumulate(items.begin(), items.end(), sum);
+                queue.consume(items.size());
+                if (items.empty()) {
+                    std::this_thread::yield();
+                }
+                i += static_cast<long>(items.size());
+            }
+            return sum;
+        });
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// Single-producer, single-consumer queue on a fixed-size ring buffer.
+//
+// The producer only ever writes tail_ and the consumer only ever writes head_, so neither
+// needs a read-modify-write - every operation is wait-free. The two indices live on separate
+// cache lines, and each side keeps a private copy of the other side's index which it only
+// refreshes when the ring looks full (producer) or empty (consumer). Most operations thus
+// don't touch the other side's cache line at all.
+//
+// The slots hold constructed T's, which is what makes the zero-copy interface possible: the
+// producer can reserve() a run of free slots, fill them in place and commit() them, and the
+// consumer can look at a run of queued elements with peek() and consume() them when done.
+//
+// Exactly one thread may push and exactly one thread may pop at any one time.
+
+template<typename T>
+class spsc_queue {
+private:
+    static constexpr std::size_t cache_line_size{64};
+    static_assert(std::is_default_constructible_v<T>,
+                  "spsc_queue keeps its slots constructed - T must be default constructible");
+
+    static std::size_t round_up_to_power_of_2(std::size_t n) noexcept
+    {
+        std::size_t result{2};
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // --- member data
+    std::size_t const mask_;
+    std::unique_ptr<T[]> slots_;
+    // producer side
+    alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_{0};
+    // consumer side
+    alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_{0};
+
+    // number of free slots as far as the producer knows, refreshing its copy of head_ if
+    // fewer than `wanted`
+    std::size_t free_slots(std::size_t tail, std::size_t wanted) noexcept
+    {
+        auto free = capacity() - (tail - cached_head_);
+        if (free < wanted) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free = capacity() - (tail - cached_head_);
+        }
+        return free;
+    }
+
+    // number of queued elements as far as the consumer knows, refreshing its copy of tail_
+    // if fewer than `wanted`
+    std::size_t queued(std::size_t head, std::size_t wanted) noexcept
+    {
+        auto available = cached_tail_ - head;
+        if (available < wanted) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            available = cached_tail_ - head;
+        }
+        return available;
+    }
+
+public:
+    using value_type = T;
+    static constexpr std::size_t default_capacity{1024};
+
+    // capacity is rounded up to the next power of two
+    explicit spsc_queue(std::size_t capacity = default_capacity)
+        : mask_{round_up_to_power_of_2(capacity) - 1}, slots_{new T[mask_ + 1]}
+    {
+    }
+
+    spsc_queue(spsc_queue const&) = delete;
+    spsc_queue& operator=(spsc_queue const&) = delete;
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // --- producer
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        if (free_slots(tail, 1) == 0) {
+            return false;
+        }
+        slots_[tail & mask_] = T(std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T const& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    // Pushes up to `count` elements from `first` - as many as there is room for.
+    // Returns how many were pushed; they become visible to the consumer all at once.
+    template<typename InputIt>
+    std::size_t push_n(InputIt first, std::size_t count)
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        count = std::min(count, free_slots(tail, count));
+        for (std::size_t i{0}; i != count; ++i, ++first) {
+            slots_[(tail + i) & mask_] = *first;
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Up to `count` contiguous free slots to be filled in place - fewer if the ring is nearly
+    // full or the run wraps around the end of the buffer. Nothing is published until commit().
+    std::span<T> reserve(std::size_t count) noexcept
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        auto const index = tail & mask_;
+        count = std::min({count, free_slots(tail, count), capacity() - index});
+        return {slots_.get() + index, count};
+    }
+
+    // publishes the first `count` slots of the last reserve()
+    void commit(std::size_t count) noexcept
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // --- consumer
+
+    bool try_pop(T& value)
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        if (queued(head, 1) == 0) {
+            return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to `count` elements into `out`. Returns how many were popped.
+    template<typename OutputIt>
+    std::size_t pop_n(OutputIt out, std::size_t count)
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        count = std::min(count, queued(head, count));
+        for (std::size_t i{0}; i != count; ++i, ++out) {
+            *out = std::move(slots_[(head + i) & mask_]);
+        }
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Up to `count` contiguous queued elements, in queue order, to be read in place. The slots
+    // stay owned by the consumer until they're released with consume().
+    std::span<T> peek(std::size_t count) noexcept
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        auto const index = head & mask_;
+        count = std::min({count, queued(head, count), capacity() - index});
+        return {slots_.get() + index, count};
+    }
+
+    // hands the first `count` elements of the last peek() back to the producer
+    void consume(std::size_t count) noexcept
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // --- either side - only a snapshot while the other side is active
+
+    std::size_t size() const noexcept
+    {
+        // head_ first - it can never overtake a tail_ read after it
+        auto const head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+};
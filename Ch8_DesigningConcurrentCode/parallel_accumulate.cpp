@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "parallel_accumulate.hpp"
+
+// parallel_accumulate in the different summation modes: how long it takes to sum up doubles
+// of all magnitudes, and how far off the result is. Pass the number of doubles to try other
+// sizes.
+
+int main(int argc, char* argv[])
+{
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20'000'000ul};
+    std::vector<double> values(size);
+    std::mt19937_64 rng{42};
+    std::uniform_real_distribution<double> mantissa{-1.0, 1.0};
+    std::uniform_int_distribution<int> exponent{-20, 20};
+    std::generate(values.begin(), values.end(),
+                  [&] { return std::ldexp(mantissa(rng), exponent(rng)); });
+    long double exact{0.0l};
+    long double compensation{0.0l};
+    for (auto const v : values) {
+        summation_detail::kahan_add(exact, compensation, static_cast<long double>(v));
+    }
+
+    std::cerr << std::setw(16) << "" << std::setw(10) << "seconds" << std::setw(14)
+              << "rel. error\n";
+    for (auto const& [name, mode] : {std::pair{"in_order", summation::in_order},
+                                     std::pair{"reassociate", summation::reassociate},
+                                     std::pair{"pairwise", summation::pairwise},
+                                     std::pair{"compensated", summation::compensated}}) {
+        auto const start{std::chrono::steady_clock::now()};
+        auto const sum{parallel_accumulate(values.cbegin(), values.cend(), 0.0, mode)};
+        std::chrono::duration<double> const time{std::chrono::steady_clock::now() - start};
+        std::cerr << std::left << std::setw(16) << name << std::right << std::fixed
+                  << std::setprecision(4) << std::setw(10) << time.count() << std::scientific
+                  << std::setprecision(2) << std::setw(12)
+                  << static_cast<double>(std::fabs((sum - exact) / exact)) << "\n";
+    }
+
+    // bit for bit what the serial version computes - so the number of threads can't matter
+    auto const start{std::chrono::steady_clock::now()};
+    auto const sum{parallel_deterministic_accumulate(values.cbegin(), values.cend(), 0.0)};
+    std::chrono::duration<double> const time{std::chrono::steady_clock::now() - start};
+    std::cerr << std::left << std::setw(16) << "deterministic" << std::right << std::fixed
+              << std::setprecision(4) << std::setw(10) << time.count() << "    "
+              << (sum == deterministic_accumulate(values.cbegin(), values.cend(), 0.0)
+                      ? "matches"
+                      : "DIFFERS FROM")
+              << " the serial sum\n";
+
+    std::vector<long> numbers(10'000'000);
+    std::iota(numbers.begin(), numbers.end(), 0l);
+    std::cerr << "\nsum of 0.." << numbers.size() - 1 << " = "
+              << parallel_accumulate(numbers.cbegin(), numbers.cend(), 0l) << "\n";
+}
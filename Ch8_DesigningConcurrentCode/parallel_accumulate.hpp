@@ -2,39 +2,53 @@
 
 #include <algorithm>
 #include <future>
-#include <iostream>
+#include <iterator>
+#include <numeric>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "join_threads.hpp"
+#include "summation_kernels.hpp"
 
+// If T is the element type, the blocks are summed up by sum_range - which uses vector registers
+// for arithmetic types, for floating point only if mode allows the reordering.
 template <typename Iterator, typename T>
-T parallel_accumulate(Iterator begin, Iterator end, T init)
+T parallel_accumulate(Iterator begin, Iterator end, T init, summation mode = summation::in_order)
 {
     auto const length{std::distance(begin, end)};
+    using size_type = decltype(length);
     if (length == 0) {
         return init;
     }
-    unsigned const min_per_thread{25u};
-    unsigned const max_threads{(length + min_per_thread - 1) / min_per_thread};
-    unsigned const num_threads{std::min(
-        std::max(std::thread::hardware_concurrency(), 2), max_threads)};
-    unsigned const block_size{length / num_threads};
-    std::vector<std::future<T>> futures(num_threads - 1);
-    std::vector<std::thread> threads(num_threads - 1);
+    size_type const min_per_thread{25};
+    size_type const max_threads{(length + min_per_thread - 1) / min_per_thread};
+    auto const num_threads{
+        std::min(static_cast<size_type>(std::max(std::thread::hardware_concurrency(), 2u)),
+                 max_threads)};
+    size_type const block_size{length / num_threads};
+    auto const block_sum{[mode](Iterator b, Iterator e) {
+        if constexpr (std::is_same_v<std::iter_value_t<Iterator>, T>) {
+            return sum_range(b, e, mode);
+        }
+        else {
+            return std::accumulate(b, e, T{});
+        }
+    }};
+
+    std::vector<std::future<T>> futures(static_cast<std::size_t>(num_threads - 1));
+    std::vector<std::thread> threads(static_cast<std::size_t>(num_threads - 1));
     join_threads joiner{threads};
 
     auto block_begin{begin};
-    for (auto i{0u}; i < (num_threads - 1); ++i) {
-        auto block_end{block_begin};
-        std::advance(block_end, block_size);
-        std::packaged_task<T(Iterator, Iterator)> task{
-            [](Iterator b, Iterator e) { return std::accumulate(b, e, T{}); }};
+    for (std::size_t i{0}; i != threads.size(); ++i) {
+        auto const block_end{std::next(block_begin, block_size)};
+        std::packaged_task<T(Iterator, Iterator)> task{block_sum};
         futures[i] = task.get_future();
         threads[i] = std::thread{std::move(task), block_begin, block_end};
         block_begin = block_end;
     }
-    auto const last_result{std::accumulate(block_begin, end, T{})};
+    auto const last_result{block_sum(block_begin, end)};
     auto result{init};
     for (auto& f : futures) {
         result += f.get();
@@ -42,3 +56,45 @@ T parallel_accumulate(Iterator begin, Iterator end, T init)
     result += last_result;
     return result;
 }
+
+// Like parallel_accumulate, but the result only depends on the elements, init and mode - not on
+// the number of threads - see summation_kernels.hpp. It's what deterministic_accumulate
+// returns.
+template <typename Iterator, typename T>
+T parallel_deterministic_accumulate(Iterator begin, Iterator end, T init,
+                                    summation mode = summation::reassociate)
+{
+    auto const length{std::distance(begin, end)};
+    using size_type = decltype(length);
+    auto const block_count{(length + deterministic_block - 1) / deterministic_block};
+    if (block_count == 0) {
+        return init;
+    }
+    auto const num_threads{std::min(
+        static_cast<size_type>(std::max(std::thread::hardware_concurrency(), 2u)), block_count)};
+    std::vector<T> sums(static_cast<std::size_t>(block_count));
+    // how the blocks are shared out doesn't matter - only that every block is summed as a whole
+    auto const sum_blocks{[&sums, begin, length, block_count, num_threads, mode](size_type t) {
+        for (auto i{block_count * t / num_threads}; i != block_count * (t + 1) / num_threads;
+             ++i) {
+            sums[static_cast<std::size_t>(i)] =
+                summation_detail::block_sum<T>(begin, length, i, mode);
+        }
+    }};
+
+    std::vector<std::future<void>> futures(static_cast<std::size_t>(num_threads - 1));
+    {
+        std::vector<std::thread> threads(static_cast<std::size_t>(num_threads - 1));
+        join_threads joiner{threads};
+        for (std::size_t i{0}; i != threads.size(); ++i) {
+            std::packaged_task<void(size_type)> task{sum_blocks};
+            futures[i] = task.get_future();
+            threads[i] = std::thread{std::move(task), static_cast<size_type>(i)};
+        }
+        sum_blocks(num_threads - 1);
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    return init + summation_detail::combine_block_sums(sums);
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parallel_find.hpp"
+
+// parallel_find against std::find with the match at different positions - the earlier it is,
+// the less work either has to do - and the other searches checked against their serial
+// counterparts. Pass the number of elements to try larger sizes.
+
+namespace
+{
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
+
+void check(std::string const& what, bool ok)
+{
+    std::cerr << std::left << std::setw(44) << what << (ok ? "ok" : "WRONG") << "\n";
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // the checks below need a few million elements
+    auto const size{std::max(argc > 1 ? std::strtol(argv[1], nullptr, 10) : 50'000'000l,
+                             2'000'000l)};
+    std::vector<long> data(static_cast<std::size_t>(size));
+    std::iota(data.begin(), data.end(), 0l);
+
+    std::cerr << std::left << std::setw(16) << "match at" << std::right << std::setw(10)
+              << "std::find" << std::setw(10) << "parallel" << "    (seconds)\n";
+    for (auto const position : {0l, 1'000l, 100'000l, size / 2, size - 1, size}) {
+        auto expected{data.end()};
+        auto found{data.end()};
+        auto const serial{
+            seconds([&] { expected = std::find(data.begin(), data.end(), position); })};
+        auto const parallel{
+            seconds([&] { found = parallel_find(data.begin(), data.end(), position); })};
+        std::cerr << std::left << std::setw(16)
+                  << (position == size ? std::string{"none"} : std::to_string(position))
+                  << std::right << std::fixed << std::setprecision(5) << std::setw(10) << serial
+                  << std::setw(10) << parallel << "    " << (found == expected ? "ok" : "WRONG")
+                  << "\n";
+    }
+    std::cerr << "\n";
+
+    // many matches - it has to be the first one
+    auto const is_multiple{[](long x) { return x != 0 && x % 1'000'003 == 0; }};
+    check("find_if returns the first of many matches",
+          parallel_find_if(data.begin(), data.end(), is_multiple) ==
+              std::find_if(data.begin(), data.end(), is_multiple));
+    check("any_of",
+          parallel_any_of(data.begin(), data.end(), is_multiple) &&
+              !parallel_any_of(data.begin(), data.end(), [](long x) { return x < 0; }));
+    check("all_of",
+          parallel_all_of(data.begin(), data.end(), [](long x) { return x >= 0; }) &&
+              !parallel_all_of(data.begin(), data.end(), [size](long x) { return x < size - 1; }));
+
+    auto copy{data};
+    check("mismatch of equal ranges",
+          parallel_mismatch(data.begin(), data.end(), copy.begin()).first == data.end());
+    copy[copy.size() - 10] = -1;
+    copy[copy.size() / 3] = -1;
+    check("mismatch finds the first difference",
+          parallel_mismatch(data.begin(), data.end(), copy.begin()) ==
+              std::mismatch(data.begin(), data.end(), copy.begin()));
+
+    // an exception is only rethrown if it comes before any match
+    auto const throws_late{[size](long x) {
+        if (x == size - 2) {
+            throw std::runtime_error{"predicate failed"};
+        }
+        return x == size / 2;
+    }};
+    check("a match before an exception wins",
+          parallel_find_if(data.begin(), data.end(), throws_late) ==
+              data.begin() + size / 2);
+    auto const throws_early{[size](long x) {
+        if (x == size / 4) {
+            throw std::runtime_error{"predicate failed"};
+        }
+        return x == size / 2;
+    }};
+    try {
+        parallel_find_if(data.begin(), data.end(), throws_early);
+        check("an exception before any match is rethrown", false);
+    }
+    catch (std::runtime_error const&) {
+        check("an exception before any match is rethrown", true);
+    }
+}
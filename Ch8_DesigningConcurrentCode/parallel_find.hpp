@@ -1,81 +1,232 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
 #include <exception>
-#include <future>
+#include <functional>
+#include <iterator>
+#include <mutex>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "join_threads.hpp"
 
-template <typename Iterator, typename MatchType>
-Iterator parallel_find(Iterator begin, Iterator end, MatchType match)
-{
-    struct find_element {
-        std::promise<Iterator>& result_;
-        std::atomic_bool& done_flag_;
-        MatchType const& match_;
-
-        find_element(std::promise<Iterator>& result,
-                     std::atomic_bool& done_flag, MatchType const& match)
-            : result_{result}, done_flag_{done_flag_}, match_{match}
-        {
+/**
+ * Parallel searches that return the first match - the same element the serial algorithm
+ * would - and stop as early as they can.
+ *
+ * Instead of one contiguous block per thread, the range is dealt out in chunks, in order: a
+ * thread that is done with a chunk takes the next one nobody has taken yet. So all threads
+ * work near the front of what's left, and a match early in the range is found after little
+ * more than its position's worth of work, however many threads there are. The chunks start
+ * small and double in size up to max_chunk, and the calling thread searches the chunks that
+ * end within the first probe_length elements on its own before starting any threads - a match
+ * right at the front costs no thread start-up at all.
+ *
+ * The threads share a cancellation_token with the position of the first match found so far.
+ * A match at i cancels exactly the work past i: chunks that start after it are skipped, the
+ * ones before it are still searched, since they might hold an earlier match. An exception
+ * from the predicate counts as a match at its chunk's start and is rethrown if nothing
+ * earlier turns up - as it would have been by the serial algorithm.
+ *
+ * The chunks are found with std::next, so the searches are meant for random-access
+ * iterators.
+ */
+
+// The position of the first match found so far by the threads of one search, and the
+// exception to rethrow if the search stopped at one.
+class cancellation_token {
+public:
+    explicit cancellation_token(std::ptrdiff_t length) noexcept : first_{length} {}
+
+    cancellation_token(cancellation_token const&) = delete;
+    cancellation_token& operator=(cancellation_token const&) = delete;
+
+    // whether the elements from index on needn't be searched anymore
+    bool is_cancelled(std::ptrdiff_t index) const noexcept
+    {
+        return index >= first_.load(std::memory_order_relaxed);
+    }
+
+    void found(std::ptrdiff_t index) noexcept
+    {
+        auto first{first_.load(std::memory_order_relaxed)};
+        while (index < first &&
+               !first_.compare_exchange_weak(first, index, std::memory_order_relaxed)) {
         }
+    }
 
-        void operator(Iterator begin, Iterator end)
+    void failed(std::ptrdiff_t index, std::exception_ptr error)
+    {
         {
-            try {
-                for (; (begin != end) && done_flag.load() == false; ++begin) {
-                    if (*begin == match) {
-                        result.set_value(*begin);
-                        done_flag.store(true);
-                        return;
-                    }
-                }
+            std::lock_guard<std::mutex> lock{error_mutex_};
+            if (!error_ || index < error_index_) {
+                error_ = std::move(error);
+                error_index_ = index;
             }
-            catch (...) {
-                try {
-                    result.set_exception(std::current_excption());
-                    done_flag.store(true);
-                }
-                catch (...) {
-                    // trying to .store_exception() on a promise that already
-                    // has a value set might throw an exception - catch it and
-                    // ignore it
-                }
+        }
+        found(index);
+    }
+
+    // the first match - call once the threads are done
+    std::ptrdiff_t first() const
+    {
+        auto const first{first_.load(std::memory_order_relaxed)};
+        if (error_ && error_index_ == first) {
+            std::rethrow_exception(error_);
+        }
+        return first;
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> first_;
+    std::mutex error_mutex_{};
+    std::exception_ptr error_{};
+    std::ptrdiff_t error_index_{0};
+};
+
+namespace parallel_find_detail {
+
+constexpr std::ptrdiff_t min_chunk{256};
+constexpr std::ptrdiff_t max_chunk{1 << 14};
+constexpr std::ptrdiff_t probe_length{1 << 12};
+
+// the index-th chunk: min_chunk, 2 min_chunk, 4 min_chunk ... elements, up to max_chunk
+inline std::pair<std::ptrdiff_t, std::ptrdiff_t> chunk(std::ptrdiff_t index,
+                                                       std::ptrdiff_t length) noexcept
+{
+    // the chunks before the first one of max_chunk elements
+    constexpr auto growing{std::countr_zero(static_cast<std::size_t>(max_chunk / min_chunk))};
+    std::ptrdiff_t begin{};
+    std::ptrdiff_t size{};
+    if (index < growing) {
+        begin = min_chunk * ((std::ptrdiff_t{1} << index) - 1);
+        size = min_chunk << index;
+    }
+    else {
+        begin = max_chunk - min_chunk + (index - growing) * max_chunk;
+        size = max_chunk;
+    }
+    return {std::min(begin, length), std::min(begin + size, length)};
+}
+
+// The index of the first element in [0, length) for which search finds a match, or length.
+// search(b, e) searches the elements [b, e) and returns the index of the first match there,
+// or e.
+template <typename Search>
+std::ptrdiff_t find_first(std::ptrdiff_t length, Search const& search)
+{
+    cancellation_token token{length};
+    std::atomic<std::ptrdiff_t> next_chunk{0};
+    auto const search_chunk{[&token, &search](std::ptrdiff_t b, std::ptrdiff_t e) {
+        try {
+            if (auto const i{search(b, e)}; i != e) {
+                token.found(i);
             }
         }
-    };
+        catch (...) {
+            token.failed(b, std::current_exception());
+        }
+    }};
 
-    auto const length{std::distance(begin, end)};
-    using size_type = decltype(length);
-    if (0 == length) {
-        return end;
+    // probing - there's no one else yet to take the chunks. It stops short of the chunk that
+    // crosses probe_length, which can be almost as large as everything before it.
+    for (;;) {
+        auto const [b, e]{chunk(next_chunk.load(std::memory_order_relaxed), length)};
+        if (b == length || e > probe_length || token.is_cancelled(b)) {
+            break;
+        }
+        next_chunk.fetch_add(1, std::memory_order_relaxed);
+        search_chunk(b, e);
     }
-    unsigned const min_per_thread{25u};
-    size_type const max_threads{(length + min_per_thread - 1) / min_per_thread};
-    size_type const num_threads{std::min(
-        std::max(std::thread::hardware_concurrency(), 2), max_threads)};
-    size_type const block_size{length / num_threads};
-
-    std::promise<Iterator> result{};
-    std::atomic_bool done_flag{false};
-    std::vector<std::thread> threads(num_threads - 1);
+    auto const remaining{length - chunk(next_chunk.load(), length).first};
+    if (token.is_cancelled(length - remaining) || remaining == 0) {
+        return token.first();
+    }
+
+    auto const work{[&] {
+        for (;;) {
+            auto const [b, e]{chunk(next_chunk.fetch_add(1, std::memory_order_relaxed), length)};
+            // the chunks only get later from here on
+            if (b == length || token.is_cancelled(b)) {
+                return;
+            }
+            search_chunk(b, e);
+        }
+    }};
+    auto const num_threads{std::min(
+        static_cast<std::ptrdiff_t>(std::max(std::thread::hardware_concurrency(), 2u)),
+        (remaining + max_chunk - 1) / max_chunk)};
     {
-        // introduce additional scope to ensure that all threads have done their work
-        // by the time we check if the result has been found
+        std::vector<std::thread> threads(static_cast<std::size_t>(num_threads - 1));
         join_threads joiner{threads};
-        auto block_begin{begin};
-        for (auto i{0u}; i < (num_threads - 1); ++i) {
-            auto const block_end{std::next(block_begin, block_size)};
-            threads[i] = std::thread{find_element{result, match, done_flag},
-                                     block_begin, block_end};
-            block_begin = block_end;
+        for (auto& t : threads) {
+            t = std::thread{work};
         }
-        find_element{result, match, done_flag}(block_begin, end);
-    }
-    if (done_flag.load() == false) {
-        return end;
+        work();
     }
-    return result.get_future().get();
+    return token.first();
+}
+
+} // namespace parallel_find_detail
+
+// The first element for which pred holds, or end.
+template <typename Iterator, typename Predicate>
+Iterator parallel_find_if(Iterator begin, Iterator end, Predicate pred)
+{
+    auto const length{std::distance(begin, end)};
+    return std::next(begin, parallel_find_detail::find_first(
+                                length, [begin, &pred](std::ptrdiff_t b, std::ptrdiff_t e) {
+                                    auto const first{std::next(begin, b)};
+                                    return b + std::distance(
+                                                   first,
+                                                   std::find_if(first, std::next(first, e - b),
+                                                                std::ref(pred)));
+                                }));
+}
+
+// The first element equal to match, or end.
+template <typename Iterator, typename MatchType>
+Iterator parallel_find(Iterator begin, Iterator end, MatchType const& match)
+{
+    return parallel_find_if(begin, end, [&match](auto const& x) { return x == match; });
+}
+
+template <typename Iterator, typename Predicate>
+bool parallel_any_of(Iterator begin, Iterator end, Predicate pred)
+{
+    return parallel_find_if(begin, end, std::move(pred)) != end;
+}
+
+template <typename Iterator, typename Predicate>
+bool parallel_all_of(Iterator begin, Iterator end, Predicate pred)
+{
+    return parallel_find_if(begin, end, [&pred](auto const& x) { return !pred(x); }) == end;
+}
+
+// The first position at which [begin1, end1) and the range starting at begin2 differ, i.e.
+// where pred(x, y) doesn't hold.
+template <typename Iterator1, typename Iterator2, typename BinaryPredicate>
+std::pair<Iterator1, Iterator2> parallel_mismatch(Iterator1 begin1, Iterator1 end1,
+                                                  Iterator2 begin2, BinaryPredicate pred)
+{
+    auto const i{parallel_find_detail::find_first(
+        std::distance(begin1, end1),
+        [begin1, begin2, &pred](std::ptrdiff_t b, std::ptrdiff_t e) {
+            auto const first1{std::next(begin1, b)};
+            return b + std::distance(first1, std::mismatch(first1, std::next(first1, e - b),
+                                                           std::next(begin2, b), std::ref(pred))
+                                                 .first);
+        })};
+    return {std::next(begin1, i), std::next(begin2, i)};
+}
+
+template <typename Iterator1, typename Iterator2>
+std::pair<Iterator1, Iterator2> parallel_mismatch(Iterator1 begin1, Iterator1 end1,
+                                                  Iterator2 begin2)
+{
+    return parallel_mismatch(begin1, end1, begin2, std::equal_to<>{});
 }
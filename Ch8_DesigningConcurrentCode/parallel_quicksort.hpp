@@ -9,6 +9,7 @@
 #include <type_traits>
 
 #include "joining_thread.hpp"
+#include "node_allocator.hpp"
 #include "threadsafe_stack.hpp"
 
 template <typename T>
@@ -19,7 +20,7 @@ struct sorter {
     };
 
     // --- member data
-    threadsafe_stack<chunk_to_sort> chunks{};
+    threadsafe_stack<chunk_to_sort, node_allocator<chunk_to_sort>> chunks{};
     std::vector<std::thread> threads{};
     unsigned const max_thread_count{max_threads() - 1};
     std::atomic_bool end_of_data{false};
@@ -43,9 +44,9 @@ struct sorter {
 
     void try_sort_chunk()
     {
-        auto const p_chunk = chunks.try_pop();
-        if (p_chunk) {
-            sort_chunk(*p_chunk);
+        // a chunk_to_sort allocates its promise's state - only build one for a chunk that's there
+        if (auto chunk{chunks.try_pop_value()}) {
+            sort_chunk(*chunk);
         }
     }
 
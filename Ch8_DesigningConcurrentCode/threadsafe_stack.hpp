@@ -4,41 +4,66 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <type_traits>
 #include <utility>
 
-template <typename T>
+// Nodes are allocated through Allocator (rebound to the node type) and hold the values
+// themselves. Pushing costs a single node allocation and popping into a T& doesn't allocate;
+// only the unique_ptr returning pops allocate their result.
+template <typename T, typename Allocator = std::allocator<T>>
 class threadsafe_stack {
   private:
-    struct node {
-        std::unique_ptr<T> data{};
-        std::unique_ptr<node> next{};
+    struct node;
+    using node_allocator_type =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator_type>;
 
-        node() = default;
-        template <typename... Args,
-            typename = std::enable_if_t<std::is_constructible_v<T, Args...>>>
-        node(Args&&... args)
-            : data{std::make_unique<T>(std::forward<Args>(args)...)}
+    struct node_deleter {
+        node_allocator_type allocator{};
+
+        void operator()(node* p) noexcept
         {
+            node_traits::destroy(allocator, p);
+            node_traits::deallocate(allocator, p, 1);
         }
-        node(T&& value)
-            : data{std::make_unique<T>(std::move(value))}
+    };
+    using node_ptr = std::unique_ptr<node, node_deleter>;
+
+    struct node {
+        std::optional<T> data{};
+        node_ptr next{};
+
+        node() = default;
+        template <typename... Args>
+        explicit node(std::in_place_t, Args&&... args)
+            : data{std::in_place, std::forward<Args>(args)...}
         {
         }
-        ~node() noexcept = default;
-        node(node const&) = default;
-        node(node&&) noexcept = default;
-        node& operator=(node const&) = default;
-        node& operator=(node&&) noexcept = default;
     };
 
     // --- member variables
+    node_allocator_type allocator_{};
     mutable std::mutex head_mutex_{};
     mutable std::condition_variable data_cond_{};
     node head{};
     // ---
 
-    void push_node(std::unique_ptr<node>&& new_node)
+    template <typename... Args>
+    node_ptr make_node(Args&&... args)
+    {
+        auto* const p{node_traits::allocate(allocator_, 1)};
+        try {
+            node_traits::construct(allocator_, p, std::in_place, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            node_traits::deallocate(allocator_, p, 1);
+            throw;
+        }
+        return node_ptr{p, node_deleter{allocator_}};
+    }
+
+    void push_node(node_ptr&& new_node)
     {
         {
             std::lock_guard<std::mutex> lk{head_mutex_};
@@ -51,34 +76,37 @@ class threadsafe_stack {
   public:
     using value_type = std::unique_ptr<T>;
     threadsafe_stack() = default;
+    explicit threadsafe_stack(Allocator const& allocator)
+        : allocator_{allocator}
+    {
+    }
 
     template <typename... Args>
-    std::enable_if_t<std::is_constructible_v<node, Args...>>
+    std::enable_if_t<std::is_constructible_v<T, Args...>>
     emplace(Args&&... args)
     {
-        auto new_node{std::make_unique<node>(std::forward<Args>(args)...)};
-        push_node(std::move(new_node));
+        push_node(make_node(std::forward<Args>(args)...));
     }
 
     void push(T&& value)
     {
-        auto new_node{std::make_unique<node>(std::move(value))};
-        push_node(std::move(new_node));
+        push_node(make_node(std::move(value)));
     }
 
     void push(T const& value)
     {
-        auto new_node{std::make_unique<node>(value)};
-        push_node(std::move(new_node));
+        push_node(make_node(value));
     }
 
     std::unique_ptr<T> wait_and_pop()
     {
         std::unique_lock<std::mutex> lk{head_mutex_};
         data_cond_.wait(lk, [this] { return head.next != nullptr; });
+        // allocate before unlinking - if that throws, the stack is left untouched
+        auto result{std::make_unique<T>(std::move(*head.next->data))};
         auto old_head = std::move(head.next);
         head.next = std::move(old_head->next);
-        return std::move(old_head->data);
+        return result;
     }
 
     void wait_and_pop(T& value)
@@ -97,9 +125,10 @@ class threadsafe_stack {
         if (head.next == nullptr) {
             return nullptr;
         }
+        auto result{std::make_unique<T>(std::move(*head.next->data))};
         auto old_head = std::move(head.next);
         head.next = std::move(old_head->next);
-        return std::move(old_head->data);
+        return result;
     }
 
     bool try_pop(T& value)
@@ -114,6 +143,21 @@ class threadsafe_stack {
         return true;
     }
 
+    // Nothing has to be constructed up front to pop into, and nothing is if the stack is empty.
+    std::optional<T> try_pop_value()
+    {
+        node_ptr old_head{};
+        {
+            std::lock_guard<std::mutex> lk{head_mutex_};
+            if (head.next == nullptr) {
+                return std::nullopt;
+            }
+            old_head = std::move(head.next);
+            head.next = std::move(old_head->next);
+        }
+        return std::move(old_head->data);
+    }
+
     bool empty() const noexcept
     {
         std::lock_guard<std::mutex> lk{head_mutex_};
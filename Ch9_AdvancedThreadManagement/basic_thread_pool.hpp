@@ -6,6 +6,7 @@
 #include <thread>
 #include <vector>
 
+#include "event_count.hpp"
 #include "join_threads.hpp"
 #include "threadsafe_queue.hpp"
 
@@ -26,24 +27,32 @@ public:
         }
     }
 
-    ~thread_pool() noexcept { done_ = true; }
+    ~thread_pool() noexcept
+    {
+        done_ = true;
+        work_available_.notify_all();
+    }
 
     template <typename Function>
     void submit(Function&& f)
     {
         work_queue_.push(std::function<void()>{std::forward<Function>(f)});
+        work_available_.notify_one();
     }
 
 private:
     void worker_thread()
     {
+        spin_then_park idle_strategy{};
         while (!done_) {
             std::function<void()> task;
             if (work_queue_.try_pop(task)) {
+                idle_strategy.reset();
                 task();
             }
             else {
-                std::this_thread::yield();
+                idle_strategy.idle(work_available_,
+                                   [this] { return done_ || !work_queue_.empty(); });
             }
         }
     }
@@ -51,6 +60,7 @@ private:
     // --- member data
     std::atomic_bool done_{false};
     threadsafe_queue<std::function<void()>> work_queue_{};
+    event_count work_available_{};
     std::vector<std::thread> threads_{};
     join_threads joiner_{threads_};
 };
\ No newline at end of file
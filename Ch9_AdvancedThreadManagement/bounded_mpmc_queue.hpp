@@ -0,0 +1,236 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Bounded multi-producer, multi-consumer queue on a ring buffer (Dmitry Vyukov's design).
+//
+// Every slot carries a sequence number telling whose turn it is: a slot at position `pos` is
+// free for the producer of ticket `pos` when sequence == pos, and holds data for the consumer
+// of ticket `pos` when sequence == pos + 1. Producers and consumers only ever contend on
+// their own index, and a handoff through a slot is a single release store.
+// - try_push/try_pop claim a ticket with compare-exchange only when the slot is ready,
+//   so they never wait.
+// - push/wait_and_pop grab a ticket unconditionally and then wait for their slot - first
+//   spinning, then sleeping on the slot's sequence number. That's what gives back-pressure:
+//   producers block while the queue is full.
+// - the *_until variants retry the try_ versions until the deadline.
+// After construction there are no allocations at all.
+
+template<typename T>
+class bounded_mpmc_queue {
+private:
+    static constexpr std::size_t cache_line_size{64};
+    static constexpr unsigned spin_limit{128};
+    // the slot handoff must not fail half-way once a ticket has been claimed
+    static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+                  "bounded_mpmc_queue requires a nothrow movable T");
+
+    struct alignas(cache_line_size) cell {
+        std::atomic<std::size_t> sequence{0};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T& data() noexcept { return *std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    static std::size_t round_up_to_power_of_2(std::size_t n) noexcept
+    {
+        std::size_t result{2};
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static std::ptrdiff_t distance(std::size_t sequence, std::size_t position) noexcept
+    {
+        return static_cast<std::ptrdiff_t>(sequence - position);
+    }
+
+    // block until the slot's sequence reaches `expected`
+    static void wait_for_turn(cell& c, std::size_t expected) noexcept
+    {
+        for (auto spins{0u};; ++spins) {
+            auto const sequence = c.sequence.load(std::memory_order_acquire);
+            if (sequence == expected) {
+                return;
+            }
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                c.sequence.wait(sequence, std::memory_order_acquire);
+            }
+        }
+    }
+
+    static void hand_over(cell& c, std::size_t sequence) noexcept
+    {
+        c.sequence.store(sequence, std::memory_order_release);
+        c.sequence.notify_all();
+    }
+
+    template<typename Clock, typename Function>
+    static bool retry_until(std::chrono::time_point<Clock> deadline, Function try_once)
+    {
+        for (auto spins{0u};; ++spins) {
+            if (try_once()) {
+                return true;
+            }
+            if (Clock::now() >= deadline) {
+                return false;
+            }
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds{50});
+            }
+        }
+    }
+
+    // --- member data
+    std::size_t const mask_;
+    std::unique_ptr<cell[]> cells_;
+    alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos_{0};
+
+public:
+    using value_type = T;
+    static constexpr std::size_t default_capacity{1024};
+
+    // capacity is rounded up to the next power of two
+    explicit bounded_mpmc_queue(std::size_t capacity = default_capacity)
+        : mask_{round_up_to_power_of_2(capacity) - 1}, cells_{new cell[mask_ + 1]}
+    {
+        for (std::size_t i{0}; i != mask_ + 1; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_mpmc_queue(bounded_mpmc_queue const&) = delete;
+    bounded_mpmc_queue& operator=(bounded_mpmc_queue const&) = delete;
+
+    ~bounded_mpmc_queue() noexcept
+    {
+        // no other thread may access the queue anymore - destroy whatever is still queued
+        auto const end = enqueue_pos_.load(std::memory_order_relaxed);
+        for (auto pos = dequeue_pos_.load(std::memory_order_relaxed); distance(end, pos) > 0;
+             ++pos) {
+            auto& c = cells_[pos & mask_];
+            if (c.sequence.load(std::memory_order_relaxed) == pos + 1) {
+                c.data().~T();
+            }
+        }
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // `value` is only moved from if the push succeeds
+    bool try_push(T&& value)
+    {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell* c;
+        for (;;) {
+            c = &cells_[pos & mask_];
+            auto const diff = distance(c->sequence.load(std::memory_order_acquire), pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // full
+            }
+            else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void*>(c->storage)) T{std::move(value)};
+        hand_over(*c, pos + 1);
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell* c;
+        for (;;) {
+            c = &cells_[pos & mask_];
+            auto const diff = distance(c->sequence.load(std::memory_order_acquire), pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // empty
+            }
+            else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(c->data());
+        c->data().~T();
+        hand_over(*c, pos + mask_ + 1);
+        return true;
+    }
+
+    bool try_push(T const& value)
+    {
+        return try_push(T(value));
+    }
+
+    // blocks while the queue is full
+    void push(T value)
+    {
+        auto const pos = enqueue_pos_.fetch_add(1, std::memory_order_relaxed);
+        auto& c = cells_[pos & mask_];
+        wait_for_turn(c, pos);
+        ::new (static_cast<void*>(c.storage)) T{std::move(value)};
+        hand_over(c, pos + 1);
+    }
+
+    template<typename... Args>
+    std::enable_if_t<std::is_constructible_v<T, Args...>> emplace(Args&&... args)
+    {
+        // construct up front - nothing may throw once we hold a ticket
+        push(T(std::forward<Args>(args)...));
+    }
+
+    // blocks while the queue is empty
+    void wait_and_pop(T& value)
+    {
+        auto const pos = dequeue_pos_.fetch_add(1, std::memory_order_relaxed);
+        auto& c = cells_[pos & mask_];
+        wait_for_turn(c, pos + 1);
+        value = std::move(c.data());
+        c.data().~T();
+        hand_over(c, pos + mask_ + 1);
+    }
+
+    // `value` is only moved from if the push succeeds
+    template<typename Clock>
+    bool push_until(T& value, std::chrono::time_point<Clock> deadline)
+    {
+        return retry_until(deadline, [this, &value] { return try_push(std::move(value)); });
+    }
+
+    template<typename Clock>
+    bool wait_and_pop_until(T& value, std::chrono::time_point<Clock> deadline)
+    {
+        return retry_until(deadline, [this, &value] { return try_pop(value); });
+    }
+
+    // only a snapshot - other threads may change it right after
+    bool empty() const noexcept
+    {
+        return distance(enqueue_pos_.load(std::memory_order_relaxed),
+                        dequeue_pos_.load(std::memory_order_relaxed)) <= 0;
+    }
+};
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// The submitting thread produces tasks much faster than the workers can run them. With the
+// unbounded queue the backlog just keeps growing; the bounded pool makes submit() wait
+// instead, so the backlog never exceeds the queue's capacity.
+template <typename Pool>
+void flood(char const* name)
+{
+    constexpr auto task_count{20000};
+    std::atomic<int> completed{0};
+    int max_backlog{0};
+    {
+        Pool pool{};
+        std::vector<task_future<void>> futures{};
+        futures.reserve(task_count);
+        for (auto i{0}; i != task_count; ++i) {
+            futures.push_back(pool.submit([&completed] {
+                std::this_thread::sleep_for(std::chrono::microseconds{20});
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }));
+            max_backlog = std::max(max_backlog, i + 1 - completed.load(std::memory_order_relaxed));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
+    std::cerr << name << ": completed " << completed.load() << " tasks, max backlog "
+              << max_backlog << "\n";
+}
+
+int main()
+{
+    flood<thread_pool<>>("unbounded queue");
+    flood<bounded_thread_pool>("bounded queue");
+}
@@ -1,46 +1,126 @@
 #pragma once
 
-#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <utility>
 
-class function_wrapper {
-    struct impl_base {
-        constexpr impl_base() noexcept = default;
-        impl_base(impl_base const&) = delete;
-        impl_base(impl_base&&) = delete;
-        impl_base& operator=(impl_base const&) = delete;
-        impl_base& operator=(impl_base&&) = delete;
-        virtual void invoke() = 0;
-        virtual ~impl_base() noexcept = default;
+/**
+ * Move-only `void()` callable used for thread pool tasks.
+ *
+ * Unlike std::function it does not require the callable to be copyable, so it can hold
+ * std::packaged_task. Callables that fit into InlineSize bytes (and are nothrow movable) are
+ * constructed directly in the wrapper's own storage, anything bigger falls back to the heap.
+ * Type erasure goes through one static table of function pointers per callable type, so there's
+ * no virtual base class and no allocation needed just to get dynamic dispatch.
+ */
+
+template <std::size_t InlineSize>
+class basic_function_wrapper {
+    static_assert(InlineSize >= sizeof(void*), "inline storage must be able to hold a pointer");
+
+    struct vtable {
+        void (*invoke)(void* storage);
+        // move-construct the callable into `to` and destroy what's left in `from`
+        void (*relocate)(void* to, void* from) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename Function>
+    static constexpr bool is_stored_inline{sizeof(Function) <= InlineSize &&
+                                           alignof(Function) <= alignof(std::max_align_t) &&
+                                           std::is_nothrow_move_constructible_v<Function>};
+
+    template <typename Function>
+    struct inline_storage {
+        static Function& get(void* storage) noexcept
+        {
+            return *std::launder(static_cast<Function*>(storage));
+        }
+        static void invoke(void* storage) { get(storage)(); }
+        static void relocate(void* to, void* from) noexcept
+        {
+            ::new (to) Function{std::move(get(from))};
+            get(from).~Function();
+        }
+        static void destroy(void* storage) noexcept { get(storage).~Function(); }
+
+        static constexpr vtable table{&invoke, &relocate, &destroy};
     };
 
     template <typename Function>
-    struct impl_type : impl_base {
-        Function function_;
-        constexpr impl_type(Function&& f) : function_{std::move(f)} {}
-        void invoke() override { function_(); }
+    struct heap_storage {
+        static Function*& get(void* storage) noexcept
+        {
+            return *std::launder(static_cast<Function**>(storage));
+        }
+        static void invoke(void* storage) { (*get(storage))(); }
+        static void relocate(void* to, void* from) noexcept { ::new (to) Function*{get(from)}; }
+        static void destroy(void* storage) noexcept { delete get(storage); }
+
+        static constexpr vtable table{&invoke, &relocate, &destroy};
     };
 
-    std::unique_ptr<impl_base> impl_{};
+    // --- member data
+    alignas(std::max_align_t) unsigned char storage_[InlineSize]{};
+    vtable const* vtable_{nullptr};
+
+    void reset() noexcept
+    {
+        if (vtable_) {
+            vtable_->destroy(storage_);
+            vtable_ = nullptr;
+        }
+    }
 
 public:
-    function_wrapper() noexcept = default;
+    static constexpr std::size_t inline_size{InlineSize};
+
+    basic_function_wrapper() noexcept = default;
 
-    template <typename F, typename = std::enable_if_t<!std::is_same_v<F, function_wrapper>>>
-    function_wrapper(F&& f)
-        : impl_{std::make_unique<impl_type<std::decay_t<F>>>(std::forward<F>(f))}
+    template <typename F, typename Function = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Function, basic_function_wrapper>>>
+    basic_function_wrapper(F&& f)
     {
+        if constexpr (is_stored_inline<Function>) {
+            ::new (static_cast<void*>(storage_)) Function{std::forward<F>(f)};
+            vtable_ = &inline_storage<Function>::table;
+        }
+        else {
+            ::new (static_cast<void*>(storage_)) Function*{new Function{std::forward<F>(f)}};
+            vtable_ = &heap_storage<Function>::table;
+        }
     }
 
-    function_wrapper(function_wrapper&& other) noexcept : impl_{std::move(other.impl_)} {}
-    function_wrapper& operator=(function_wrapper&& other) noexcept
+    basic_function_wrapper(basic_function_wrapper&& other) noexcept : vtable_{other.vtable_}
     {
-        impl_ = std::move(other.impl_);
+        if (vtable_) {
+            vtable_->relocate(storage_, other.storage_);
+            other.vtable_ = nullptr;
+        }
+    }
+
+    basic_function_wrapper& operator=(basic_function_wrapper&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.vtable_) {
+                other.vtable_->relocate(storage_, other.storage_);
+                vtable_ = std::exchange(other.vtable_, nullptr);
+            }
+        }
         return *this;
     }
 
-    function_wrapper(function_wrapper const&) = delete;
-    function_wrapper& operator=(function_wrapper const&) = delete;
+    basic_function_wrapper(basic_function_wrapper const&) = delete;
+    basic_function_wrapper& operator=(basic_function_wrapper const&) = delete;
+
+    ~basic_function_wrapper() noexcept { reset(); }
 
-    void operator()() { impl_->invoke(); }
+    void operator()() { vtable_->invoke(storage_); }
+
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
 };
+
+// 48 bytes of inline storage - the whole wrapper fits a single 64 byte cache line
+using function_wrapper = basic_function_wrapper<48>;
@@ -0,0 +1,93 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "function_wrapper.hpp"
+#include "task_future.hpp"
+
+// Count every allocation made by the program - that's the number we're after.
+namespace
+{
+std::atomic<std::size_t> allocation_count{0};
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+template <typename Wrapper, typename MakeTask>
+void run_benchmark(std::string const& name, MakeTask make_task)
+{
+    constexpr std::size_t iterations{1'000'000};
+    // simulates the lifetime of a task in a pool - constructed by submit(),
+    // moved into and out of the queue, invoked by a worker
+    std::vector<Wrapper> queue;
+    queue.reserve(1);
+
+    auto const allocations_before{allocation_count.load()};
+    auto const start{std::chrono::steady_clock::now()};
+    for (auto i{0u}; i != iterations; ++i) {
+        queue.push_back(Wrapper{make_task(i)});
+        Wrapper task{std::move(queue.back())};
+        queue.pop_back();
+        task();
+    }
+    auto const elapsed{std::chrono::steady_clock::now() - start};
+    auto const allocations{allocation_count.load() - allocations_before};
+
+    std::cerr << name << ": "
+              << static_cast<double>(allocations) / static_cast<double>(iterations)
+              << " allocations/task, "
+              << std::chrono::duration<double, std::nano>{elapsed}.count() /
+                     static_cast<double>(iterations)
+              << " ns/task\n";
+}
+
+int main()
+{
+    std::size_t sink{0};
+    // a typical task - captures a few references and an index
+    auto const small_task{[&sink, offset = std::size_t{3}, scale = std::size_t{7}](unsigned i) {
+        return [&sink, offset, scale, i] { sink += i * scale + offset; };
+    }};
+    // a task that captures far more state than fits inline
+    auto const large_task{[&sink](unsigned i) {
+        std::array<std::size_t, 16> payload{};
+        payload[i % payload.size()] = i;
+        return [&sink, payload] { sink += payload[0]; };
+    }};
+    auto const packaged_task{[&sink](unsigned i) {
+        return std::packaged_task<void()>{[&sink, i] { sink += i; }};
+    }};
+    auto const pool_task{[&sink](unsigned i) {
+        auto [task, future]{make_pool_task([&sink, i] { sink += i; })};
+        return std::move(task);
+    }};
+
+    std::cerr << "sizeof(function_wrapper) = " << sizeof(function_wrapper)
+              << ", inline storage = " << function_wrapper::inline_size << " bytes\n";
+    run_benchmark<function_wrapper>("function_wrapper, small lambda", small_task);
+    run_benchmark<std::function<void()>>("std::function,    small lambda", small_task);
+    run_benchmark<function_wrapper>("function_wrapper, large lambda", large_task);
+    run_benchmark<std::function<void()>>("std::function,    large lambda", large_task);
+    // what is left here is allocated by std::packaged_task itself (shared state and result)
+    run_benchmark<function_wrapper>("function_wrapper, packaged_task", packaged_task);
+    // callable, result and completion flag share one block
+    run_benchmark<function_wrapper>("function_wrapper, pool_task", pool_task);
+    std::cerr << "(sink = " << sink << ")\n";
+}
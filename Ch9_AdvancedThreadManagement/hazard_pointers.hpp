@@ -0,0 +1,291 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Hazard pointers - safe memory reclamation for lock-free data structures.
+//
+// Before dereferencing a shared node a thread publishes its address in a hazard pointer slot
+// owned by that thread. A node that has been unlinked from the data structure is not deleted
+// right away but `retire`d onto a per-thread list. Once that list grows past a threshold
+// proportional to the number of hazard pointer slots in existence, the thread scans all the
+// slots and deletes every retired node that nobody has published. The threshold makes the
+// scan cost amortised O(1) per retired node and at the same time bounds the number of nodes
+// that can be awaiting reclamation - each thread holds at most `threshold` of them, no matter
+// how contended the data structure is.
+
+class hazard_pointer_domain {
+public:
+    struct hazard_record {
+        std::atomic<void const*> pointer{nullptr};
+        std::atomic<bool> active{false};
+        hazard_record* next{nullptr};
+    };
+
+    struct retired_pointer {
+        void* pointer;
+        void (*deleter)(void*);
+    };
+
+    static hazard_pointer_domain& instance()
+    {
+        static hazard_pointer_domain domain{};
+        return domain;
+    }
+
+    hazard_pointer_domain(hazard_pointer_domain const&) = delete;
+    hazard_pointer_domain& operator=(hazard_pointer_domain const&) = delete;
+
+    ~hazard_pointer_domain() noexcept
+    {
+        // only reached on program exit - nobody can hold a hazard pointer anymore
+        for (auto const& retired : orphans_) {
+            retired.deleter(retired.pointer);
+        }
+        auto* record{records_.load()};
+        while (record) {
+            delete std::exchange(record, record->next);
+        }
+    }
+
+    hazard_record* acquire_record()
+    {
+        // try to reuse a record released by some other thread first
+        for (auto* record{records_.load(std::memory_order_acquire)}; record;
+             record = record->next) {
+            bool expected{false};
+            if (!record->active.load(std::memory_order_relaxed) &&
+                record->active.compare_exchange_strong(expected, true)) {
+                return record;
+            }
+        }
+        auto* const record{new hazard_record{}};
+        record->active.store(true, std::memory_order_relaxed);
+        record->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                               std::memory_order_relaxed))
+            ;
+        record_count_.fetch_add(1, std::memory_order_relaxed);
+        return record;
+    }
+
+    void release_record(hazard_record* record) noexcept
+    {
+        record->pointer.store(nullptr, std::memory_order_release);
+        record->active.store(false, std::memory_order_release);
+    }
+
+    std::size_t scan_threshold() const noexcept
+    {
+        return 2 * record_count_.load(std::memory_order_relaxed) + 64;
+    }
+
+    // Deletes every pointer in `retired` that isn't protected by any hazard pointer,
+    // leaving only the protected ones behind.
+    void scan(std::vector<retired_pointer>& retired)
+    {
+        adopt_orphans(retired);
+        auto const retired_before{retired.size()};
+
+        // pairs with the seq_cst store in hazard_pointer::protect() - either we see the
+        // published pointer, or the protecting thread sees that the node has been unlinked
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::vector<void const*> hazards;
+        for (auto* record{records_.load(std::memory_order_acquire)}; record;
+             record = record->next) {
+            if (auto const* const p{record->pointer.load(std::memory_order_acquire)}) {
+                hazards.push_back(p);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        auto const still_hazardous{std::partition(
+            retired.begin(), retired.end(), [&hazards](retired_pointer const& r) {
+                return std::binary_search(hazards.cbegin(), hazards.cend(), r.pointer);
+            })};
+        std::for_each(still_hazardous, retired.end(),
+                      [](retired_pointer const& r) { r.deleter(r.pointer); });
+        retired.erase(still_hazardous, retired.end());
+
+        reclaimed_.fetch_add(retired_before - retired.size(), std::memory_order_relaxed);
+    }
+
+    // called on thread exit with whatever that thread couldn't reclaim yet
+    void add_orphans(std::vector<retired_pointer> const& retired)
+    {
+        if (retired.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{orphans_mutex_};
+        orphans_.insert(orphans_.end(), retired.cbegin(), retired.cend());
+        has_orphans_.store(true, std::memory_order_release);
+    }
+
+    void note_retired(std::size_t count) noexcept
+    {
+        retired_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Approximate number of retired nodes that haven't been deleted yet - retirements are
+    // reported in batches, at scan time.
+    std::size_t pending_reclamation() const noexcept
+    {
+        return retired_.load(std::memory_order_relaxed) -
+               reclaimed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    hazard_pointer_domain() = default;
+
+    void adopt_orphans(std::vector<retired_pointer>& retired)
+    {
+        if (!has_orphans_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock{orphans_mutex_, std::try_to_lock};
+        if (lock.owns_lock()) {
+            retired.insert(retired.end(), orphans_.cbegin(), orphans_.cend());
+            orphans_.clear();
+            has_orphans_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // --- member data
+    std::atomic<hazard_record*> records_{nullptr};
+    std::atomic<std::size_t> record_count_{0};
+    std::atomic<std::size_t> retired_{0};
+    std::atomic<std::size_t> reclaimed_{0};
+    std::atomic<bool> has_orphans_{false};
+    std::mutex orphans_mutex_{};
+    std::vector<retired_pointer> orphans_{};
+};
+
+// Per-thread cache of hazard records and the thread's list of retired pointers.
+class hazard_pointer_thread_state {
+public:
+    static hazard_pointer_thread_state& instance()
+    {
+        static thread_local hazard_pointer_thread_state state{};
+        return state;
+    }
+
+    hazard_pointer_thread_state(hazard_pointer_thread_state const&) = delete;
+    hazard_pointer_thread_state& operator=(hazard_pointer_thread_state const&) = delete;
+
+    ~hazard_pointer_thread_state() noexcept
+    {
+        auto& domain{hazard_pointer_domain::instance()};
+        for (auto* record : free_records_) {
+            domain.release_record(record);
+        }
+        domain.note_retired(unreported_);
+        domain.scan(retired_);
+        domain.add_orphans(retired_);
+    }
+
+    hazard_pointer_domain::hazard_record* acquire()
+    {
+        if (free_records_.empty()) {
+            return hazard_pointer_domain::instance().acquire_record();
+        }
+        auto* const record{free_records_.back()};
+        free_records_.pop_back();
+        return record;
+    }
+
+    void release(hazard_pointer_domain::hazard_record* record)
+    {
+        record->pointer.store(nullptr, std::memory_order_release);
+        free_records_.push_back(record);
+    }
+
+    void retire(void* pointer, void (*deleter)(void*))
+    {
+        retired_.push_back({pointer, deleter});
+        ++unreported_;
+        auto& domain{hazard_pointer_domain::instance()};
+        if (retired_.size() >= domain.scan_threshold()) {
+            domain.note_retired(std::exchange(unreported_, 0));
+            domain.scan(retired_);
+        }
+    }
+
+private:
+    hazard_pointer_thread_state() = default;
+
+    std::vector<hazard_pointer_domain::hazard_record*> free_records_{};
+    std::vector<hazard_pointer_domain::retired_pointer> retired_{};
+    std::size_t unreported_{0};
+};
+
+// RAII owner of a single hazard pointer slot.
+class hazard_pointer {
+public:
+    hazard_pointer() : record_{hazard_pointer_thread_state::instance().acquire()} {}
+
+    hazard_pointer(hazard_pointer const&) = delete;
+    hazard_pointer& operator=(hazard_pointer const&) = delete;
+
+    ~hazard_pointer() noexcept { hazard_pointer_thread_state::instance().release(record_); }
+
+    // Loads `src` and publishes the loaded value until it's stable - the returned pointer can
+    // be safely dereferenced until the hazard pointer is reset or protects something else.
+    template <typename T>
+    T* protect(std::atomic<T*> const& src) noexcept
+    {
+        T* p{src.load(std::memory_order_relaxed)};
+        for (;;) {
+            record_->pointer.store(p, std::memory_order_seq_cst);
+            T* const reloaded{src.load(std::memory_order_acquire)};
+            if (reloaded == p) {
+                return p;
+            }
+            p = reloaded;
+        }
+    }
+
+    // Publishes p without checking that it's still reachable - the caller has to validate
+    // that afterwards (needed for links that carry mark bits, which protect() can't handle).
+    template <typename T>
+    void set(T* p) noexcept
+    {
+        record_->pointer.store(p, std::memory_order_seq_cst);
+    }
+
+    void reset() noexcept { record_->pointer.store(nullptr, std::memory_order_release); }
+
+private:
+    hazard_pointer_domain::hazard_record* record_;
+};
+
+template <typename T>
+void retire(T* pointer)
+{
+    hazard_pointer_thread_state::instance().retire(
+        pointer, [](void* p) { delete static_cast<T*>(p); });
+}
+
+// Reclaimer policy for the Ch7 data structures:
+// - `guard` - scoped protection of one pointer loaded from an atomic (protect()/reset()), or
+//   of a pointer that the caller validates itself (set())
+// - `guard_protects_all` - whether a guard keeps every node that was reachable while it's
+//   alive from being deleted, not just the one it was given
+// - `retire(p)` - p has been unlinked, delete it once no guard protects it anymore
+struct hazard_pointer_reclaimer {
+    using guard = hazard_pointer;
+    static constexpr bool guard_protects_all{false};
+
+    template <typename T>
+    static void retire(T* pointer)
+    {
+        ::retire(pointer);
+    }
+
+    static std::size_t pending_reclamation() noexcept
+    {
+        return hazard_pointer_domain::instance().pending_reclamation();
+    }
+};
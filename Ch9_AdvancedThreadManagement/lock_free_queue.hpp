@@ -0,0 +1,250 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "event_count.hpp"
+#include "hazard_pointers.hpp"
+
+// Multi-producer, multi-consumer lock-free queue (Michael & Scott).
+//
+// A singly linked list that always starts with a dummy node: head_ points to the dummy, the
+// first element lives in the dummy's successor. push() links the new node after the last one
+// with a compare-exchange on its `next` and then swings tail_ forward. tail_ may lag one node
+// behind for a while; every thread that notices that helps it along before carrying on, so no
+// push can ever hold up anybody else. pop() moves head_ to the successor, takes the value out
+// of it and retires the old dummy - the successor becomes the new dummy.
+//
+// Nodes are retired through the Reclaimer policy (see hazard_pointers.hpp), which is also what
+// keeps the compare-exchanges free of ABA. Values are stored in the node itself, so a push is
+// a single allocation.
+//
+// The interface is that of threadsafe_queue, so the two can be swapped for each other.
+
+template<typename T, typename Reclaimer = hazard_pointer_reclaimer>
+class lock_free_queue {
+private:
+    // a value is moved out after the node has been unlinked - that must not fail
+    static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+                  "lock_free_queue requires a nothrow movable T");
+
+    struct node {
+        std::atomic<node*> next{nullptr};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        node() = default;
+        node(node const&) = delete;
+        node& operator=(node const&) = delete;
+
+        T& value() noexcept { return *std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    // --- member data
+    alignas(64) std::atomic<node*> head_{new node};
+    alignas(64) std::atomic<node*> tail_{head_.load()};
+    event_count data_available_{};
+
+    void push_node(node* const new_node)
+    {
+        typename Reclaimer::guard tail_guard{};
+        for (;;)
+        {
+            node* tail = tail_guard.protect(tail_);
+            node* next = tail->next.load(std::memory_order_acquire);
+            if (tail != tail_.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+            if (next == nullptr)
+            {
+                if (tail->next.compare_exchange_weak(next, new_node, std::memory_order_release,
+                                                     std::memory_order_relaxed))
+                {
+                    // if this fails, somebody has already helped us
+                    tail_.compare_exchange_strong(tail, new_node, std::memory_order_release,
+                                                  std::memory_order_relaxed);
+                    break;
+                }
+            }
+            else
+            {
+                // another push has linked its node but not yet moved tail_ - do it for them
+                tail_.compare_exchange_strong(tail, next, std::memory_order_release,
+                                              std::memory_order_relaxed);
+            }
+        }
+        data_available_.notify_one();
+    }
+
+    // Unlinks the first element and hands it to `consume` as an rvalue.
+    template<typename Consumer>
+    bool try_pop_with(Consumer consume)
+    {
+        typename Reclaimer::guard head_guard{};
+        typename Reclaimer::guard next_guard{};
+        for (;;)
+        {
+            node* head = head_guard.protect(head_);
+            node* tail = tail_.load(std::memory_order_acquire);
+            node* const next = next_guard.protect(head->next);
+            if (head != head_.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+            if (next == nullptr)
+            {
+                return false;
+            }
+            if (head == tail)
+            {
+                // never let head_ overtake tail_ - a retired node must not be reachable
+                // from tail_
+                tail_.compare_exchange_strong(tail, next, std::memory_order_release,
+                                              std::memory_order_relaxed);
+                continue;
+            }
+            if (head_.compare_exchange_strong(head, next, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed))
+            {
+                // `next` is the new dummy now: its value is ours alone, and next_guard keeps
+                // it alive even if other threads pop past it in the meantime
+                consume(std::move(next->value()));
+                next->value().~T();
+                head_guard.reset();
+                next_guard.reset();
+                Reclaimer::retire(head);
+                return true;
+            }
+        }
+    }
+
+    template<typename Consumer>
+    void wait_pop_with(Consumer consume)
+    {
+        while (!try_pop_with(consume))
+        {
+            auto const key = data_available_.prepare_wait();
+            if (!empty())
+            {
+                data_available_.cancel_wait();
+            }
+            else
+            {
+                data_available_.wait(key);
+            }
+        }
+    }
+
+    // there's no timed wait on an eventcount - poll with backoff instead
+    template<typename Clock, typename Consumer>
+    bool wait_pop_with_until(std::chrono::time_point<Clock> deadline, Consumer consume)
+    {
+        for (auto spins{0u};; ++spins)
+        {
+            if (try_pop_with(consume))
+            {
+                return true;
+            }
+            if (Clock::now() >= deadline)
+            {
+                return false;
+            }
+            if (spins < 128)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds{50});
+            }
+        }
+    }
+
+    static std::shared_ptr<T> to_shared(std::optional<T>& value)
+    {
+        return value ? std::make_shared<T>(std::move(*value)) : std::shared_ptr<T>{};
+    }
+
+public:
+    lock_free_queue() = default;
+    lock_free_queue(lock_free_queue const&) = delete;
+    lock_free_queue& operator=(lock_free_queue const&) = delete;
+
+    ~lock_free_queue()
+    {
+        // no other thread may access the queue anymore - no need to go through the reclaimer
+        node* n = head_.load();
+        node* next = n->next.load();
+        delete n;  // the dummy holds no value
+        while ((n = next))
+        {
+            next = n->next.load();
+            n->value().~T();
+            delete n;
+        }
+    }
+
+    void push(T new_value)
+    {
+        emplace(std::move(new_value));
+    }
+
+    template<typename... Args>
+    std::enable_if_t<std::is_constructible_v<T, Args...>> emplace(Args&&... args)
+    {
+        // construct before linking - if that throws, the queue hasn't been touched
+        auto new_node = std::make_unique<node>();
+        ::new (static_cast<void*>(new_node->storage)) T(std::forward<Args>(args)...);
+        push_node(new_node.release());
+    }
+
+    bool try_pop(T& value)
+    {
+        return try_pop_with([&value](T&& v) { value = std::move(v); });
+    }
+
+    std::shared_ptr<T> try_pop()
+    {
+        std::optional<T> value{};
+        try_pop_with([&value](T&& v) { value.emplace(std::move(v)); });
+        return to_shared(value);
+    }
+
+    void wait_and_pop(T& value)
+    {
+        wait_pop_with([&value](T&& v) { value = std::move(v); });
+    }
+
+    std::shared_ptr<T> wait_and_pop()
+    {
+        std::optional<T> value{};
+        wait_pop_with([&value](T&& v) { value.emplace(std::move(v)); });
+        return to_shared(value);
+    }
+
+    template<typename Clock>
+    bool wait_and_pop_until(T& value, std::chrono::time_point<Clock> deadline)
+    {
+        return wait_pop_with_until(deadline, [&value](T&& v) { value = std::move(v); });
+    }
+
+    template<typename Clock>
+    std::shared_ptr<T> wait_and_pop_until(std::chrono::time_point<Clock> deadline)
+    {
+        std::optional<T> value{};
+        wait_pop_with_until(deadline, [&value](T&& v) { value.emplace(std::move(v)); });
+        return to_shared(value);
+    }
+
+    // only a snapshot - other threads may change it right after
+    bool empty() const
+    {
+        typename Reclaimer::guard head_guard{};
+        return head_guard.protect(head_)->next.load(std::memory_order_acquire) == nullptr;
+    }
+};
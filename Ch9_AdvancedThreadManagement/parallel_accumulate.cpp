@@ -1,41 +1,32 @@
 #include <algorithm>
-#include <future>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <numeric>
-#include <thread>
+#include <random>
 #include <vector>
 
+#include "parallel_algorithms.hpp"
 #include "thread_pool.hpp"
 
-template <typename Iterator, typename T>
-T parallel_accumulate(Iterator begin, Iterator end, T init)
+// Sums up doubles in the different summation modes: how long it takes and how far off the
+// result is. Pass the number of doubles to try other sizes.
+
+namespace
 {
-    auto const length{std::distance(begin, end)};
-    if (length == 0) {
-        return init;
-    }
-    auto const block_size{25u};
-    auto const num_blocks{(length + block_size - 1) / block_size};
-    std::vector<std::future<T>> futures(num_blocks - 1);
-    thread_pool pool{};
-    auto block_begin{begin};
-    for (auto i{0u}; i != (num_blocks - 1); ++i) {
-        auto const block_end{std::next(block_begin, block_size)};
-        futures[i] = pool.submit([b{block_begin}, e{block_end}] {
-            return std::accumulate(b, e, T{});
-        });
-        block_begin = block_end;
-    }
-    auto const last_result{std::accumulate(block_begin, end, T{})};
-    auto result{init};
-    for (auto& f : futures) {
-        result += f.get();
-    }
-    result += last_result;
-    return result;
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
 }
+} // namespace
 
-int main()
+int main(int argc, char* argv[])
 {
     std::vector<double> data;
     std::generate_n(std::back_inserter(data), 100, [d{3.14}]() mutable noexcept {
@@ -43,6 +34,56 @@ int main()
         d *= e;
         return d;
     });
-    auto const result{parallel_accumulate(data.cbegin(), data.cend(), 0.0)};
+    // the pool outlives the calls - a small sum like this one doesn't even use it
+    thread_pool pool{};
+    auto const result{parallel_accumulate(pool, data.cbegin(), data.cend(), 0.0)};
     std::cerr << "result = " << result << "\n";
+
+    std::vector<long> numbers(10'000'000);
+    std::iota(numbers.begin(), numbers.end(), 0l);
+    std::cerr << "sum of 0.." << numbers.size() - 1 << " = "
+              << parallel_accumulate(pool, numbers.cbegin(), numbers.cend(), 0l) << "\n\n";
+
+    // values of all magnitudes and both signs, which is where rounding errors pile up
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50'000'000ul};
+    std::vector<double> values(size);
+    std::mt19937_64 rng{42};
+    std::uniform_real_distribution<double> mantissa{-1.0, 1.0};
+    std::uniform_int_distribution<int> exponent{-20, 20};
+    std::generate(values.begin(), values.end(),
+                  [&] { return std::ldexp(mantissa(rng), exponent(rng)); });
+    long double exact{0.0l};
+    long double compensation{0.0l};
+    for (auto const v : values) {
+        summation_detail::kahan_add(exact, compensation, static_cast<long double>(v));
+    }
+
+    std::cerr << std::setw(24) << "" << std::setw(10) << "seconds" << std::setw(14)
+              << "rel. error\n";
+    auto const report{[exact](char const* name, double time, double sum) {
+        std::cerr << std::left << std::setw(24) << name << std::right << std::fixed
+                  << std::setprecision(4) << std::setw(10) << time << std::scientific
+                  << std::setprecision(2) << std::setw(12)
+                  << static_cast<double>(std::fabs((sum - exact) / exact)) << "\n";
+    }};
+    double sum{};
+    auto time{seconds([&] { sum = std::accumulate(values.cbegin(), values.cend(), 0.0); })};
+    report("std::accumulate", time, sum);
+    for (auto const& [name, mode] : {std::pair{"in_order", summation::in_order},
+                                    std::pair{"reassociate", summation::reassociate},
+                                    std::pair{"pairwise", summation::pairwise},
+                                    std::pair{"compensated", summation::compensated}}) {
+        time = seconds(
+            [&] { sum = parallel_accumulate(pool, values.cbegin(), values.cend(), 0.0, mode); });
+        report(name, time, sum);
+    }
+
+    // bit for bit what the serial version computes - so the number of threads can't matter
+    auto const reference{deterministic_accumulate(values.cbegin(), values.cend(), 0.0)};
+    time = seconds([&] {
+        sum = parallel_deterministic_accumulate(pool, values.cbegin(), values.cend(), 0.0);
+    });
+    report("deterministic", time, sum);
+    std::cerr << "deterministic sum " << (sum == reference ? "matches" : "DIFFERS FROM")
+              << " the serial one\n";
 }
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "parallel_algorithms.hpp"
+#include "work_stealing_thread_pool.hpp"
+
+// Time per call of the pool-based algorithms against a plain serial loop and against starting
+// hardware_concurrency() threads per call, the way Ch8's versions do - for small and large
+// inputs.
+
+namespace
+{
+template <typename Iterator>
+long thread_per_call_accumulate(Iterator begin, Iterator end)
+{
+    auto const thread_count{std::max(std::thread::hardware_concurrency(), 2u)};
+    auto const block_size{std::distance(begin, end) / thread_count};
+    std::vector<long> partial(thread_count, 0);
+    std::vector<std::thread> threads{};
+    for (auto i{0u}; i != thread_count - 1; ++i) {
+        auto const block_end{std::next(begin, block_size)};
+        threads.emplace_back([&partial, i, begin, block_end] {
+            partial[i] = std::accumulate(begin, block_end, 0l);
+        });
+        begin = block_end;
+    }
+    partial.back() = std::accumulate(begin, end, 0l);
+    for (auto& t : threads) {
+        t.join();
+    }
+    return std::accumulate(partial.cbegin(), partial.cend(), 0l);
+}
+
+template <typename Function>
+double microseconds_per_call(long calls, Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    for (long i{0}; i != calls; ++i) {
+        f();
+    }
+    return std::chrono::duration<double, std::micro>{std::chrono::steady_clock::now() - start}
+               .count() /
+           static_cast<double>(calls);
+}
+} // namespace
+
+int main()
+{
+    thread_pool pool{};
+    std::cerr << std::setw(10) << "elements" << std::setw(14) << "serial" << std::setw(14)
+              << "threads/call" << std::setw(14) << "pool" << "   (us per accumulate)\n";
+    for (long size{100}; size <= 10'000'000; size *= 100) {
+        std::vector<long> data(static_cast<std::size_t>(size));
+        std::iota(data.begin(), data.end(), 0l);
+        auto const calls{std::max(10'000'000 / size, 5l)};
+        long sink{0};
+        std::cerr << std::setw(10) << size << std::fixed << std::setprecision(2)
+                  << std::setw(14) << microseconds_per_call(calls, [&] {
+                         sink += std::accumulate(data.cbegin(), data.cend(), 0l);
+                     })
+                  << std::setw(14) << microseconds_per_call(calls, [&] {
+                         sink += thread_per_call_accumulate(data.cbegin(), data.cend());
+                     })
+                  << std::setw(14) << microseconds_per_call(calls, [&] {
+                         sink += parallel_accumulate(pool, data.cbegin(), data.cend(), 0l);
+                     })
+                  << (sink == 0 ? " " : "") << "\n";
+    }
+
+    // expensive elements get parallelised even when there are few of them
+    std::vector<double> values(2000, 2.0);
+    parallel_for_each(pool, values.begin(), values.end(), [](double& v) {
+        for (auto i{0}; i != 1000; ++i) {
+            v = std::sqrt(v + 2.0);
+        }
+    });
+    std::cerr << "for_each: " << values.front() << " ... " << values.back() << "\n";
+
+    std::vector<int> haystack(1'000'000);
+    std::iota(haystack.begin(), haystack.end(), 0);
+    auto const found{parallel_find(pool, haystack.cbegin(), haystack.cend(), 765432)};
+    auto const missing{parallel_find(pool, haystack.cbegin(), haystack.cend(), -1)};
+    std::cerr << "find: 765432 at " << std::distance(haystack.cbegin(), found) << ", -1 "
+              << (missing == haystack.cend() ? "not found" : "found") << "\n";
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "run_on_pool.hpp"
+#include "summation_kernels.hpp"
+#include "task_future.hpp"
+
+/**
+ * Parallel algorithms that run on an existing thread pool instead of starting threads of their
+ * own, as Ch8's versions do on every call. Pool is any of the pools in this chapter - anything
+ * with submit() returning a task_future and a wait(future) that helps running tasks. The
+ * calling thread takes a share of the work, too, and waits by helping, so the algorithms may
+ * also be called from inside pool tasks.
+ *
+ * How much parallelism pays off depends on what a call costs, which the element count alone
+ * doesn't tell. Ranges of up to serial_length elements are simply done serially, as is
+ * everything on a machine with a single hardware thread. For longer ones the calling thread
+ * starts on the first elements by itself, in chunks that double in size from serial_length on,
+ * until that has taken measurably long - the clock is only read around chunks of at least
+ * timed_length elements, where that costs little next to the chunk. The time per element then
+ * decides: if the rest would be done within serial_cutoff, it's done serially - the small calls
+ * on hot paths never touch the pool. Otherwise the rest is split into at most
+ * chunks_per_thread chunks per hardware thread, each worth at least min_chunk_time, so that
+ * the per-task overhead stays small compared to the work.
+ */
+
+namespace parallel_detail {
+
+using clock = std::chrono::steady_clock;
+
+// the time per element is measured once probing the first elements has taken this long
+constexpr std::chrono::nanoseconds probe_time{std::chrono::microseconds{2}};
+// less remaining work than this isn't worth waking up workers for
+constexpr std::chrono::nanoseconds serial_cutoff{std::chrono::microseconds{50}};
+constexpr std::chrono::nanoseconds min_chunk_time{std::chrono::microseconds{10}};
+constexpr std::ptrdiff_t chunks_per_thread{4};
+// ranges up to this long are done serially right away, without measuring anything
+constexpr std::ptrdiff_t serial_length{128};
+// probing measures the chunks from this length on
+constexpr std::ptrdiff_t timed_length{256};
+
+// std::thread::hardware_concurrency() asks the system anew on every call, which costs more than
+// the small calls of the algorithms
+inline unsigned hardware_threads() noexcept
+{
+    static unsigned const count{std::thread::hardware_concurrency()};
+    return count;
+}
+
+// what body(begin, end) returns for the algorithms that don't produce anything
+struct no_result {
+};
+
+// Calls body(b, e) on consecutive chunks of [begin, end) - on the calling thread or in the
+// pool, see above - and hands the results to combine(result) in the order of the chunks. Stops
+// early once combine returns true for a chunk done on the calling thread while probing; chunks
+// in the pool have to check for themselves whether to bother.
+template <typename Pool, typename Iterator, typename Body, typename Combine>
+void run_chunked(Pool& pool, Iterator begin, Iterator end, Body& body, Combine combine)
+{
+    using result_type = std::invoke_result_t<Body&, Iterator, Iterator>;
+
+    auto remaining{std::distance(begin, end)};
+    // with a single hardware thread the pool's workers could only take turns with this one
+    if (remaining <= serial_length || hardware_threads() <= 1) {
+        if (remaining != 0) {
+            combine(body(begin, end));
+        }
+        return;
+    }
+    clock::time_point start{};
+    std::ptrdiff_t timed{0};
+    clock::duration elapsed{};
+    for (auto probe_length{serial_length}; remaining != 0; probe_length *= 2) {
+        if (probe_length == timed_length) {
+            start = clock::now();
+        }
+        auto const length{std::min(probe_length, remaining)};
+        auto const chunk_end{std::next(begin, length)};
+        auto const stop{combine(body(begin, chunk_end))};
+        begin = chunk_end;
+        remaining -= length;
+        if (stop) {
+            return;
+        }
+        if (probe_length >= timed_length) {
+            timed += length;
+            elapsed = clock::now() - start;
+            if (elapsed >= probe_time) {
+                break;
+            }
+        }
+    }
+    if (remaining == 0) {
+        return;
+    }
+
+    auto const time_left{std::chrono::duration<double, std::nano>{elapsed} / timed *
+                         static_cast<double>(remaining)};
+    if (time_left < serial_cutoff) {
+        combine(body(begin, end));
+        return;
+    }
+    auto const max_chunks{chunks_per_thread * std::max<std::ptrdiff_t>(hardware_threads(), 1)};
+    auto const chunk_count{std::clamp(static_cast<std::ptrdiff_t>(time_left / min_chunk_time),
+                                      std::ptrdiff_t{1}, std::min(max_chunks, remaining))};
+
+    // the last chunk is the calling thread's
+    std::vector<task_future<result_type>> futures{};
+    futures.reserve(static_cast<std::size_t>(chunk_count - 1));
+    auto const wait_for_all{[&pool, &futures] {
+        for (auto const& f : futures) {
+            pool.wait(f);
+        }
+    }};
+    try {
+        for (std::ptrdiff_t i{0}; i != chunk_count - 1; ++i) {
+            // spread the remainder over the first chunks
+            auto const length{remaining / chunk_count + (i < remaining % chunk_count ? 1 : 0)};
+            auto const chunk_end{std::next(begin, length)};
+            futures.push_back(
+                pool.submit([&body, b{begin}, e{chunk_end}] { return body(b, e); }));
+            begin = chunk_end;
+        }
+        auto last{body(begin, end)};
+        wait_for_all();
+        for (auto& f : futures) {
+            if (combine(f.get())) {
+                return;
+            }
+        }
+        combine(std::move(last));
+    }
+    catch (...) {
+        // the tasks refer to body and the range - they must be done before we leave
+        wait_for_all();
+        throw;
+    }
+}
+
+// the combine of run_chunked for the algorithms that don't produce anything
+inline bool ignore(no_result) noexcept
+{
+    return false;
+}
+
+} // namespace parallel_detail
+
+// f is called concurrently - it must be safe to call from several threads at once.
+template <typename Pool, typename Iterator, typename Function>
+void parallel_for_each(Pool& pool, Iterator begin, Iterator end, Function f)
+{
+    auto body{[&f](Iterator b, Iterator e) {
+        std::for_each(b, e, std::ref(f));
+        return parallel_detail::no_result{};
+    }};
+    parallel_detail::run_chunked(pool, begin, end, body, parallel_detail::ignore);
+}
+
+// The partial sums of consecutive chunks are added up in order, starting from init. If T is
+// the element type, the chunks are summed up by sum_range - which uses vector registers for
+// arithmetic types, for floating point only if mode allows the reordering.
+template <typename Pool, typename Iterator, typename T>
+T parallel_accumulate(Pool& pool, Iterator begin, Iterator end, T init,
+                      summation mode = summation::in_order)
+{
+    auto body{[mode](Iterator b, Iterator e) {
+        if constexpr (std::is_same_v<std::iter_value_t<Iterator>, T>) {
+            return sum_range(b, e, mode);
+        }
+        else {
+            return std::accumulate(b, e, T{});
+        }
+    }};
+    parallel_detail::run_chunked(pool, begin, end, body, [&init](auto&& partial) {
+        init = std::move(init) + std::move(partial);
+        return false;
+    });
+    return init;
+}
+
+// std::transform_reduce on the pool: reduce(... reduce(reduce(init, transform(x0)),
+// transform(x1)) ...) for the elements x of the range, without storing the transformed values
+// anywhere - every element is read once. As for std::transform_reduce, reduce has to be
+// associative: every chunk folds its own elements, then the chunks' results are folded into
+// init in order. Both functions are called concurrently.
+template <typename Pool, typename Iterator, typename T, typename ReduceOp, typename TransformOp>
+T parallel_transform_reduce(Pool& pool, Iterator begin, Iterator end, T init, ReduceOp reduce,
+                            TransformOp transform)
+{
+    auto body{[&reduce, &transform](Iterator b, Iterator e) {
+        T res(transform(*b));
+        while (++b != e) {
+            res = reduce(std::move(res), transform(*b));
+        }
+        return res;
+    }};
+    parallel_detail::run_chunked(pool, begin, end, body, [&init, &reduce](auto&& partial) {
+        init = reduce(std::move(init), std::move(partial));
+        return false;
+    });
+    return init;
+}
+
+// The same over pairs of elements, transform(x, y) for x from [begin1, end1) and y from the
+// range starting at begin2. Finding a chunk's start in the second range takes std::next, so
+// with iterators that aren't random-access every chunk walks up to its start first.
+template <typename Pool, typename Iterator1, typename Iterator2, typename T, typename ReduceOp,
+          typename TransformOp>
+T parallel_transform_reduce(Pool& pool, Iterator1 begin1, Iterator1 end1, Iterator2 begin2,
+                            T init, ReduceOp reduce, TransformOp transform)
+{
+    auto body{[&reduce, &transform, begin1, begin2](Iterator1 b, Iterator1 e) {
+        auto b2{std::next(begin2, std::distance(begin1, b))};
+        T res(transform(*b, *b2));
+        while (++b != e) {
+            res = reduce(std::move(res), transform(*b, *++b2));
+        }
+        return res;
+    }};
+    parallel_detail::run_chunked(pool, begin1, end1, body, [&init, &reduce](auto&& partial) {
+        init = reduce(std::move(init), std::move(partial));
+        return false;
+    });
+    return init;
+}
+
+// The inner product of [begin1, end1) and the range starting at begin2, plus init.
+template <typename Pool, typename Iterator1, typename Iterator2, typename T>
+T parallel_transform_reduce(Pool& pool, Iterator1 begin1, Iterator1 end1, Iterator2 begin2,
+                            T init)
+{
+    return parallel_transform_reduce(pool, begin1, end1, begin2, std::move(init), std::plus<>{},
+                                     std::multiplies<>{});
+}
+
+// Like parallel_accumulate, but the result only depends on the elements, init and mode - not on
+// the number of threads or the timing - see summation_kernels.hpp. It's what
+// deterministic_accumulate returns, and has about the same throughput as parallel_accumulate.
+template <typename Pool, typename Iterator, typename T>
+T parallel_deterministic_accumulate(Pool& pool, Iterator begin, Iterator end, T init,
+                                    summation mode = summation::reassociate)
+{
+    auto const n{std::distance(begin, end)};
+    auto const block_count{(n + deterministic_block - 1) / deterministic_block};
+    std::vector<T> sums(static_cast<std::size_t>(block_count));
+    // how the blocks are shared out doesn't matter - only that every block is summed as a whole
+    auto const task_count{std::min(
+        block_count, parallel_detail::chunks_per_thread *
+                         std::max<std::ptrdiff_t>(std::thread::hardware_concurrency(), 1))};
+    run_on_pool(pool, task_count, [&](std::ptrdiff_t task) {
+        for (auto i{block_count * task / task_count}; i != block_count * (task + 1) / task_count;
+             ++i) {
+            sums[static_cast<std::size_t>(i)] =
+                summation_detail::block_sum<T>(begin, n, i, mode);
+        }
+    });
+    return init + summation_detail::combine_block_sums(sums);
+}
+
+// Returns an iterator to an element equal to match, or end. Once any chunk has found one, the
+// others give up - so with several matches, it's not necessarily the first.
+template <typename Pool, typename Iterator, typename MatchType>
+Iterator parallel_find(Pool& pool, Iterator begin, Iterator end, MatchType const& match)
+{
+    std::atomic_bool found{false};
+    auto body{[&found, &match](Iterator b, Iterator e) -> std::optional<Iterator> {
+        for (; b != e && !found.load(std::memory_order_relaxed); ++b) {
+            if (*b == match) {
+                found.store(true, std::memory_order_relaxed);
+                return b;
+            }
+        }
+        return std::nullopt;
+    }};
+    auto res{end};
+    parallel_detail::run_chunked(pool, begin, end, body,
+                                 [&res](std::optional<Iterator> const& result) {
+                                     if (result) {
+                                         res = *result;
+                                     }
+                                     return result.has_value();
+                                 });
+    return res;
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel_scan.hpp"
+#include "work_stealing_thread_pool.hpp"
+
+// parallel_inclusive_scan and parallel_exclusive_scan against their std counterparts, and a
+// stream compaction built on the exclusive scan: the positions of the kept elements are the
+// prefix sums of the keep flags. Pass the number of elements to try other sizes.
+
+namespace
+{
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
+
+void report(std::string const& name, double serial, double parallel, bool ok)
+{
+    std::cerr << std::left << std::setw(32) << name << std::right << std::fixed
+              << std::setprecision(4) << std::setw(10) << serial << std::setw(10) << parallel
+              << "    " << (ok ? "ok" : "WRONG") << "\n";
+}
+
+template <typename T>
+void compare_scans(thread_pool& pool, std::string const& type, std::vector<T> const& input)
+{
+    std::vector<T> expected(input.size());
+    std::vector<T> result(input.size());
+    auto const serial_inclusive{seconds(
+        [&] { std::inclusive_scan(input.begin(), input.end(), expected.begin()); })};
+    auto const parallel_inclusive{seconds(
+        [&] { parallel_inclusive_scan(pool, input.begin(), input.end(), result.begin()); })};
+    report("inclusive scan, " + type, serial_inclusive, parallel_inclusive, result == expected);
+
+    auto const serial_exclusive{seconds(
+        [&] { std::exclusive_scan(input.begin(), input.end(), expected.begin(), T{}); })};
+    auto const parallel_exclusive{seconds(
+        [&] { parallel_exclusive_scan(pool, input.begin(), input.end(), result.begin(), T{}); })};
+    report("exclusive scan, " + type, serial_exclusive, parallel_exclusive, result == expected);
+
+    // in place, with an operation that doesn't get the vector kernels
+    result = input;
+    parallel_inclusive_scan(pool, result.begin(), result.end(), result.begin(),
+                            [](T a, T b) { return a + b; }, T{1});
+    std::inclusive_scan(input.begin(), input.end(), expected.begin(), std::plus<>{}, T{1});
+    report("in place, lambda, " + type, 0.0, 0.0, result == expected);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50'000'000ul};
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<std::int64_t> small{0, 100};
+
+    thread_pool pool{};
+    std::cerr << std::left << std::setw(32) << "" << std::right << std::setw(10) << "std"
+              << std::setw(10) << "parallel" << "    (seconds)\n";
+
+    std::vector<std::int64_t> integers(size);
+    std::generate(integers.begin(), integers.end(), [&] { return small(rng); });
+    compare_scans(pool, "int64", integers);
+    // small whole numbers - the sums stay exact, whatever the order of the additions
+    std::vector<double> doubles(integers.begin(), integers.end());
+    compare_scans(pool, "double", doubles);
+
+    // compaction: keep the multiples of 3 - flag them, scan the flags for the positions the
+    // kept ones go to, then move them there
+    auto const is_kept{[](std::int64_t x) { return x % 3 == 0; }};
+    std::vector<std::int64_t> expected{};
+    auto const serial{seconds([&] {
+        std::copy_if(integers.begin(), integers.end(), std::back_inserter(expected), is_kept);
+    })};
+    std::vector<std::int64_t> compacted{};
+    auto const parallel{seconds([&] {
+        auto const chunks{std::max<std::size_t>(4 * std::thread::hardware_concurrency(), 1)};
+        // calls f(i) for the indices of chunk c
+        auto const for_chunk{[&](std::ptrdiff_t c, auto f) {
+            auto const chunk{static_cast<std::size_t>(c)};
+            for (auto i{size * chunk / chunks}; i != size * (chunk + 1) / chunks; ++i) {
+                f(i);
+            }
+        }};
+        std::vector<std::int64_t> positions(size);
+        run_on_pool(pool, static_cast<std::ptrdiff_t>(chunks), [&](std::ptrdiff_t c) {
+            for_chunk(c, [&](std::size_t i) { positions[i] = is_kept(integers[i]) ? 1 : 0; });
+        });
+        parallel_exclusive_scan(pool, positions.begin(), positions.end(), positions.begin(),
+                                std::int64_t{0});
+        compacted.resize(size == 0 ? 0
+                                   : static_cast<std::size_t>(positions.back()) +
+                                         (is_kept(integers.back()) ? 1 : 0));
+        run_on_pool(pool, static_cast<std::ptrdiff_t>(chunks), [&](std::ptrdiff_t c) {
+            for_chunk(c, [&](std::size_t i) {
+                if (is_kept(integers[i])) {
+                    compacted[static_cast<std::size_t>(positions[i])] = integers[i];
+                }
+            });
+        });
+    })};
+    report("compaction, int64", serial, parallel, compacted == expected);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "run_on_pool.hpp"
+
+/**
+ * Parallel prefix sums on a thread pool - the equivalents of std::inclusive_scan and
+ * std::exclusive_scan.
+ *
+ * The range is cut into blocks of block_bytes, small enough that a block's input and output
+ * fit into L2 together. The scan then takes two passes over the blocks, both in parallel: the
+ * first one reduces every block but the last to its total, then - serially, there are only a
+ * few hundred - the totals are turned into the value every block starts from, and the second
+ * pass scans every block starting from its value. That reads the input twice and writes the
+ * output once, and the blocks take turns with the pool threads without any coordination.
+ *
+ * op has to be associative, as for std::inclusive_scan: the blocks are combined in a
+ * different order than a serial scan would. With std::plus on arithmetic types stored
+ * contiguously, the first pass keeps `lanes` separate sums, which the compiler maps onto
+ * vector registers, instead of one long chain of dependent additions. For floating point that
+ * reassociates the additions, too - results may differ from std::inclusive_scan's in the last
+ * bits. The second pass has no such kernel: it stores every element it reads, and splitting it
+ * into stretches scanned side by side measured no faster than the plain loop.
+ *
+ * out may be begin, as for the std algorithms, but the ranges must not overlap otherwise.
+ */
+
+namespace parallel_scan_detail {
+
+constexpr std::size_t block_bytes{1 << 17};
+constexpr std::ptrdiff_t lanes{8};
+
+// plus_reduce is used for +, on arithmetic types that don't get promoted
+template <typename T, typename BinaryOp, typename InputIterator>
+constexpr bool use_plus_reduce{
+    (std::is_same_v<BinaryOp, std::plus<>> || std::is_same_v<BinaryOp, std::plus<T>>) &&
+    std::is_arithmetic_v<T> && std::is_same_v<decltype(T{} + T{}), T> &&
+    std::contiguous_iterator<InputIterator> && std::is_same_v<std::iter_value_t<InputIterator>, T>};
+
+template <typename T>
+T plus_reduce(T const* in, T const* end)
+{
+    T sums[lanes]{};
+    for (; end - in >= lanes; in += lanes) {
+        for (std::ptrdiff_t j{0}; j != lanes; ++j) {
+            sums[j] += in[j];
+        }
+    }
+    T res{};
+    for (; in != end; ++in) {
+        res += *in;
+    }
+    for (auto const sum : sums) {
+        res += sum;
+    }
+    return res;
+}
+
+template <typename T, typename InputIterator, typename BinaryOp>
+T reduce_block(InputIterator begin, InputIterator end, BinaryOp& op)
+{
+    if constexpr (use_plus_reduce<T, BinaryOp, InputIterator>) {
+        return plus_reduce(std::to_address(begin), std::to_address(end));
+    }
+    else {
+        T res(*begin);
+        while (++begin != end) {
+            res = op(std::move(res), *begin);
+        }
+        return res;
+    }
+}
+
+// Scans [begin, end) into out, starting from carry - or from the first element, if there's no
+// carry, which only happens for an inclusive scan.
+template <bool exclusive, typename T, typename InputIterator, typename OutputIterator,
+          typename BinaryOp>
+void scan_block(InputIterator begin, InputIterator end, OutputIterator out, BinaryOp& op,
+                std::optional<T> carry)
+{
+    if (!carry) {
+        carry.emplace(*begin);
+        *out = *carry;
+        ++begin;
+        ++out;
+    }
+    T sum(std::move(*carry));
+    for (; begin != end; ++begin, ++out) {
+        if constexpr (exclusive) {
+            // read before writing - out may be begin
+            T value(*begin);
+            *out = sum;
+            sum = op(std::move(sum), std::move(value));
+        }
+        else {
+            sum = op(std::move(sum), *begin);
+            *out = sum;
+        }
+    }
+}
+
+template <typename T, bool exclusive, typename Pool, typename InputIterator,
+          typename OutputIterator, typename BinaryOp>
+OutputIterator scan(Pool& pool, InputIterator begin, InputIterator end, OutputIterator out,
+                    BinaryOp& op, std::optional<T> init)
+{
+    auto const n{end - begin};
+    if (n == 0) {
+        return out;
+    }
+    auto const block_length{std::max(
+        static_cast<std::ptrdiff_t>(block_bytes / sizeof(std::iter_value_t<InputIterator>)),
+        lanes)};
+    auto const block_count{(n + block_length - 1) / block_length};
+    auto const block_begin{[n, block_count](std::ptrdiff_t i) { return n * i / block_count; }};
+    if (block_count == 1) {
+        scan_block<exclusive>(begin, end, out, op, std::move(init));
+        return out + n;
+    }
+
+    // every block's total - but the last one's, which nobody needs
+    std::vector<std::optional<T>> carries(static_cast<std::size_t>(block_count));
+    run_on_pool(pool, block_count - 1, [&](std::ptrdiff_t i) {
+        carries[static_cast<std::size_t>(i) + 1] =
+            reduce_block<T>(begin + block_begin(i), begin + block_begin(i + 1), op);
+    });
+    // ... become the value every block starts from
+    carries[0] = std::move(init);
+    for (std::size_t i{1}; i != carries.size(); ++i) {
+        if (carries[i - 1]) {
+            carries[i] = op(*carries[i - 1], std::move(*carries[i]));
+        }
+    }
+    run_on_pool(pool, block_count, [&](std::ptrdiff_t i) {
+        scan_block<exclusive>(begin + block_begin(i), begin + block_begin(i + 1),
+                              out + block_begin(i), op, carries[static_cast<std::size_t>(i)]);
+    });
+    return out + n;
+}
+
+} // namespace parallel_scan_detail
+
+template <typename Pool, typename InputIterator, typename OutputIterator,
+          typename BinaryOp = std::plus<>>
+OutputIterator parallel_inclusive_scan(Pool& pool, InputIterator begin, InputIterator end,
+                                       OutputIterator out, BinaryOp op = BinaryOp{})
+{
+    return parallel_scan_detail::scan<std::iter_value_t<InputIterator>, false>(
+        pool, begin, end, out, op, std::nullopt);
+}
+
+template <typename Pool, typename InputIterator, typename OutputIterator, typename BinaryOp,
+          typename T>
+OutputIterator parallel_inclusive_scan(Pool& pool, InputIterator begin, InputIterator end,
+                                       OutputIterator out, BinaryOp op, T init)
+{
+    return parallel_scan_detail::scan<T, false>(pool, begin, end, out, op,
+                                                std::optional<T>{std::move(init)});
+}
+
+template <typename Pool, typename InputIterator, typename OutputIterator, typename T,
+          typename BinaryOp = std::plus<>>
+OutputIterator parallel_exclusive_scan(Pool& pool, InputIterator begin, InputIterator end,
+                                       OutputIterator out, T init, BinaryOp op = BinaryOp{})
+{
+    return parallel_scan_detail::scan<T, true>(pool, begin, end, out, op,
+                                               std::optional<T>{std::move(init)});
+}
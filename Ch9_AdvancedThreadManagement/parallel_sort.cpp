@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parallel_sort.hpp"
+#include "work_stealing_thread_pool.hpp"
+
+// parallel_sort against std::sort on random integers, on integers with lots of duplicates and
+// on strings. Pass the number of integers to sort to try other sizes (e.g. 100000000).
+
+namespace
+{
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
+
+template <typename T>
+void compare(thread_pool& pool, std::string const& name, std::vector<T> const& input)
+{
+    auto expected{input};
+    auto const serial{seconds([&expected] { std::sort(expected.begin(), expected.end()); })};
+    auto data{input};
+    auto const parallel{seconds([&pool, &data] { parallel_sort(pool, data.begin(), data.end()); })};
+    std::cerr << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << serial << std::setw(10) << parallel
+              << "    " << (data == expected ? "ok" : "WRONG") << "\n";
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000'000ul};
+    std::mt19937 rng{42};
+
+    thread_pool pool{};
+    std::cerr << std::left << std::setw(28) << "input" << std::right << std::setw(10)
+              << "std::sort" << std::setw(10) << "parallel" << "    (seconds)\n";
+
+    std::vector<int> numbers(size);
+    std::generate(numbers.begin(), numbers.end(), [&rng] { return static_cast<int>(rng()); });
+    compare(pool, std::to_string(size) + " random ints", numbers);
+
+    std::uniform_int_distribution<int> few_values{0, 9};
+    std::generate(numbers.begin(), numbers.end(), [&] { return few_values(rng); });
+    compare(pool, std::to_string(size) + " ints, 10 values", numbers);
+
+    std::sort(numbers.begin(), numbers.end(), std::greater<>{});
+    compare(pool, std::to_string(size) + " descending ints", numbers);
+
+    std::vector<std::string> words(size / 10);
+    std::generate(words.begin(), words.end(), [&rng] { return "word" + std::to_string(rng()); });
+    compare(pool, std::to_string(words.size()) + " strings", words);
+}
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "run_on_pool.hpp"
+
+/**
+ * In-place parallel introsort over random-access ranges, on a thread pool.
+ *
+ * Ch4's and Ch8's parallel_quicksort move the elements of a std::list around with splice()
+ * and allocate a promise per chunk. This one partitions the range in place around a pivot
+ * (the median of three, or for large ranges Tukey's ninther - the median of three medians of
+ * three), submits the lower part to the pool and carries on with the upper part itself,
+ * helping the pool while it waits. Below serial_cutoff elements, or once the recursion gets
+ * deeper than 2 log2(n) - a sign of bad pivots - the rest is left to std::sort.
+ *
+ * The first partitions of a large range are O(n) each and would keep all but one thread
+ * idle, so above parallel_partition_cutoff the partition itself runs in parallel: every chunk
+ * is partitioned on its own, and then the elements that ended up on the wrong side of the
+ * overall split point are swapped across in parallel.
+ *
+ * parallel_stable_sort keeps equal elements in their original order, which the quicksort
+ * can't. It is a bottom-up merge sort: a few runs per hardware thread are sorted with
+ * std::stable_sort in parallel, then neighbouring runs are merged pairwise, level after level,
+ * between the range and one scratch buffer allocated up front. Every merge is cut into chunks
+ * of about merge_chunk output elements that run in parallel: the co-rank of an output position
+ * - how many of the elements before it come from the first run - is found by binary search, so
+ * the chunks need no coordination. parallel_merge and parallel_multiway_merge expose the same
+ * machinery for runs that are sorted already, e.g. shards sorted by different producers.
+ *
+ * Pool is any of this chapter's pools - the work-stealing one suits the recursive submits best.
+ */
+
+namespace parallel_sort_detail {
+
+constexpr std::ptrdiff_t serial_cutoff{1 << 14};
+constexpr std::ptrdiff_t ninther_cutoff{1 << 10};
+constexpr std::ptrdiff_t parallel_partition_cutoff{1 << 20};
+constexpr std::ptrdiff_t min_partition_chunk{1 << 16};
+
+template <typename Iterator, typename Compare>
+Iterator median_of_three(Iterator a, Iterator b, Iterator c, Compare& comp)
+{
+    if (comp(*a, *b)) {
+        return comp(*b, *c) ? b : (comp(*a, *c) ? c : a);
+    }
+    return comp(*a, *c) ? a : (comp(*b, *c) ? c : b);
+}
+
+template <typename Iterator, typename Compare>
+Iterator choose_pivot(Iterator begin, Iterator end, Compare& comp)
+{
+    auto const n{end - begin};
+    auto const mid{begin + n / 2};
+    auto const last{end - 1};
+    if (n < ninther_cutoff) {
+        return median_of_three(begin, mid, last, comp);
+    }
+    auto const step{n / 8};
+    return median_of_three(median_of_three(begin, begin + step, begin + 2 * step, comp),
+                           median_of_three(mid - step, mid, mid + step, comp),
+                           median_of_three(last - 2 * step, last - step, last, comp), comp);
+}
+
+// A run of elements, as offsets from the beginning of the range.
+struct segment {
+    std::ptrdiff_t begin;
+    std::ptrdiff_t end;
+};
+
+// Calls f(offset_a, offset_b, length) for the stretches where the index-th to
+// (index + count)-th elements of the segments in a and in b line up.
+template <typename Function>
+void zip_segments(std::vector<segment> const& a, std::vector<segment> const& b,
+                  std::ptrdiff_t index, std::ptrdiff_t count, Function f)
+{
+    // skip to the segments that hold the index-th element
+    auto find{[](std::vector<segment> const& segments, std::ptrdiff_t i) {
+        std::size_t s{0};
+        while (i >= segments[s].end - segments[s].begin) {
+            i -= segments[s].end - segments[s].begin;
+            ++s;
+        }
+        return std::pair{s, segments[s].begin + i};
+    }};
+    auto [sa, pa]{find(a, index)};
+    auto [sb, pb]{find(b, index)};
+    while (count != 0) {
+        auto const length{std::min({count, a[sa].end - pa, b[sb].end - pb})};
+        f(pa, pb, length);
+        count -= length;
+        pa += length;
+        pb += length;
+        if (count != 0 && pa == a[sa].end) {
+            pa = a[++sa].begin;
+        }
+        if (count != 0 && pb == b[sb].end) {
+            pb = b[++sb].begin;
+        }
+    }
+}
+
+// std::partition, with the work split between the calling thread and the pool.
+template <typename Pool, typename Iterator, typename Predicate>
+Iterator parallel_partition(Pool& pool, Iterator begin, Iterator end, Predicate const& pred)
+{
+    auto const n{end - begin};
+    auto const chunk_count{
+        std::clamp(n / min_partition_chunk, std::ptrdiff_t{1},
+                   std::max<std::ptrdiff_t>(std::thread::hardware_concurrency(), 1))};
+    if (chunk_count == 1) {
+        return std::partition(begin, end, pred);
+    }
+
+    // every chunk [chunk_begin, chunk_end) ends up as [chunk_begin, split) true, then false
+    std::vector<std::ptrdiff_t> splits(static_cast<std::size_t>(chunk_count));
+    auto const chunk_begin{[n, chunk_count](std::ptrdiff_t i) { return n * i / chunk_count; }};
+    run_on_pool(pool, chunk_count, [&](std::ptrdiff_t i) {
+        splits[static_cast<std::size_t>(i)] =
+            std::partition(begin + chunk_begin(i), begin + chunk_begin(i + 1), pred) - begin;
+    });
+
+    // everything before `split` should be true: the false runs before it go where the true
+    // runs after it are
+    std::ptrdiff_t split{0};
+    for (std::ptrdiff_t i{0}; i != chunk_count; ++i) {
+        split += splits[static_cast<std::size_t>(i)] - chunk_begin(i);
+    }
+    std::vector<segment> misplaced_false{};
+    std::vector<segment> misplaced_true{};
+    std::ptrdiff_t misplaced{0};
+    for (std::ptrdiff_t i{0}; i != chunk_count; ++i) {
+        auto const s{splits[static_cast<std::size_t>(i)]};
+        auto const e{chunk_begin(i + 1)};
+        if (s < split && s != e) {
+            misplaced_false.push_back({s, std::min(e, split)});
+            misplaced += std::min(e, split) - s;
+        }
+        auto const b{std::max(chunk_begin(i), split)};
+        if (b < s) {
+            misplaced_true.push_back({b, s});
+        }
+    }
+    if (misplaced != 0) {
+        auto const swap_tasks{std::clamp(misplaced / min_partition_chunk, std::ptrdiff_t{1},
+                                         chunk_count)};
+        run_on_pool(pool, swap_tasks, [&](std::ptrdiff_t i) {
+            auto const first{misplaced * i / swap_tasks};
+            auto const last{misplaced * (i + 1) / swap_tasks};
+            zip_segments(misplaced_false, misplaced_true, first, last - first,
+                         [begin](std::ptrdiff_t a, std::ptrdiff_t b, std::ptrdiff_t length) {
+                             std::swap_ranges(begin + a, begin + a + length, begin + b);
+                         });
+        });
+    }
+    return begin + split;
+}
+
+template <typename Pool, typename Iterator, typename Compare>
+void sort(Pool& pool, Iterator begin, Iterator end, Compare& comp, int depth_limit)
+{
+    while (end - begin > serial_cutoff) {
+        if (depth_limit-- == 0) {
+            std::sort(begin, end, comp);
+            return;
+        }
+        auto const pivot{*choose_pivot(begin, end, comp)};
+        auto const less_than_pivot{[&comp, &pivot](auto const& x) { return comp(x, pivot); }};
+        auto middle{end - begin >= parallel_partition_cutoff
+                        ? parallel_partition(pool, begin, end, less_than_pivot)
+                        : std::partition(begin, end, less_than_pivot)};
+        if (middle == begin) {
+            // nothing is less than the pivot: move the elements equal to it out of the way, or
+            // we'd never get anywhere with lots of duplicates
+            auto const not_greater{[&comp, &pivot](auto const& x) { return !comp(pivot, x); }};
+            begin = end - begin >= parallel_partition_cutoff
+                        ? parallel_partition(pool, begin, end, not_greater)
+                        : std::partition(begin, end, not_greater);
+            continue;
+        }
+
+        auto lower{pool.submit([&pool, &comp, begin, middle, depth_limit] {
+            sort(pool, begin, middle, comp, depth_limit);
+        })};
+        try {
+            sort(pool, middle, end, comp, depth_limit);
+        }
+        catch (...) {
+            pool.wait(lower);
+            throw;
+        }
+        pool.wait(lower);
+        lower.get();
+        return;
+    }
+    std::sort(begin, end, comp);
+}
+
+constexpr std::ptrdiff_t merge_chunk{1 << 16};
+constexpr std::ptrdiff_t runs_per_thread{4};
+
+template <typename Iterator>
+using run = std::pair<Iterator, Iterator>;
+
+// How many of the first k elements of the stable merge of a[0, n) and b[0, m) come from a.
+template <typename Iterator1, typename Iterator2, typename Compare>
+std::ptrdiff_t co_rank(std::ptrdiff_t k, Iterator1 a, std::ptrdiff_t n, Iterator2 b,
+                       std::ptrdiff_t m, Compare& comp)
+{
+    auto lo{std::max(k - m, std::ptrdiff_t{0})};
+    auto hi{std::min(k, n)};
+    // the merge takes a[i] before b[j] unless b[j] < a[i]: the answer is the first i for which
+    // b[k - i - 1] < a[i]
+    while (lo < hi) {
+        auto const i{lo + (hi - lo) / 2};
+        if (comp(b[k - i - 1], a[i])) {
+            hi = i;
+        }
+        else {
+            lo = i + 1;
+        }
+    }
+    return lo;
+}
+
+// Writes the elements [k_begin, k_end) of the stable merge of a[0, n) and b[0, m) to
+// out[k_begin, k_end).
+template <typename Iterator1, typename Iterator2, typename OutputIterator, typename Compare>
+void merge_chunk_of(Iterator1 a, std::ptrdiff_t n, Iterator2 b, std::ptrdiff_t m,
+                    std::ptrdiff_t k_begin, std::ptrdiff_t k_end, OutputIterator out,
+                    Compare& comp)
+{
+    auto const i_begin{co_rank(k_begin, a, n, b, m, comp)};
+    auto const i_end{co_rank(k_end, a, n, b, m, comp)};
+    std::merge(a + i_begin, a + i_end, b + (k_begin - i_begin), b + (k_end - i_end),
+               out + k_begin, comp);
+}
+
+// Merges runs[0] with runs[1], runs[2] with runs[3] and so on into consecutive runs of out -
+// a last run without a partner is just copied - and returns the merged runs. All chunks of all
+// the merges are spread over the pool together.
+template <typename Pool, typename Iterator, typename OutputIterator, typename Compare>
+std::vector<run<OutputIterator>> merge_pairs(Pool& pool, std::vector<run<Iterator>> const& runs,
+                                             OutputIterator out, Compare& comp)
+{
+    struct chunk {
+        std::size_t first_run;
+        std::ptrdiff_t k_begin;
+        std::ptrdiff_t k_end;
+    };
+    std::vector<run<OutputIterator>> merged{};
+    std::vector<chunk> chunks{};
+    for (std::size_t r{0}; r < runs.size(); r += 2) {
+        auto length{runs[r].second - runs[r].first};
+        if (r + 1 != runs.size()) {
+            length += runs[r + 1].second - runs[r + 1].first;
+        }
+        auto const count{std::max((length + merge_chunk - 1) / merge_chunk, std::ptrdiff_t{1})};
+        for (std::ptrdiff_t i{0}; i != count; ++i) {
+            chunks.push_back({r, length * i / count, length * (i + 1) / count});
+        }
+        merged.push_back({out, out + length});
+        out += length;
+    }
+    run_on_pool(pool, static_cast<std::ptrdiff_t>(chunks.size()), [&](std::ptrdiff_t i) {
+        auto const& c{chunks[static_cast<std::size_t>(i)]};
+        auto const a{runs[c.first_run]};
+        auto const target{merged[c.first_run / 2].first};
+        if (c.first_run + 1 == runs.size()) {
+            std::copy(a.first + c.k_begin, a.first + c.k_end, target + c.k_begin);
+            return;
+        }
+        auto const b{runs[c.first_run + 1]};
+        merge_chunk_of(a.first, a.second - a.first, b.first, b.second - b.first, c.k_begin,
+                       c.k_end, target, comp);
+    });
+    return merged;
+}
+
+template <typename Iterator>
+std::vector<run<std::move_iterator<Iterator>>> moving(std::vector<run<Iterator>> const& runs)
+{
+    std::vector<run<std::move_iterator<Iterator>>> res{};
+    res.reserve(runs.size());
+    for (auto const& [b, e] : runs) {
+        res.push_back({std::make_move_iterator(b), std::make_move_iterator(e)});
+    }
+    return res;
+}
+
+// the number of levels of pairwise merges it takes to merge count runs into one
+inline int merge_levels(std::size_t count) noexcept
+{
+    return std::numeric_limits<std::size_t>::digits - std::countl_zero(count - 1);
+}
+
+// Merges the runs level after level, moving the elements back and forth between out and
+// buffer so that the last level writes to out. The runs must not overlap the level's target.
+template <typename Pool, typename Iterator, typename OutputIterator, typename BufferIterator,
+          typename Compare>
+void merge_all(Pool& pool, std::vector<run<Iterator>> const& runs, OutputIterator out,
+               BufferIterator buffer, Compare& comp)
+{
+    if (merge_levels(runs.size()) % 2 == 1) {
+        auto const merged{merge_pairs(pool, runs, out, comp)};
+        if (merged.size() != 1) {
+            merge_all(pool, moving(merged), out, buffer, comp);
+        }
+    }
+    else {
+        merge_all(pool, moving(merge_pairs(pool, runs, buffer, comp)), out, buffer, comp);
+    }
+}
+
+} // namespace parallel_sort_detail
+
+template <typename Pool, typename Iterator, typename Compare = std::less<>>
+void parallel_sort(Pool& pool, Iterator begin, Iterator end, Compare comp = Compare{})
+{
+    auto const n{static_cast<std::size_t>(end - begin)};
+    if (n < 2) {
+        return;
+    }
+    // 2 * bit_width(n)
+    auto const depth_limit{2 * (std::numeric_limits<std::size_t>::digits - std::countl_zero(n))};
+    parallel_sort_detail::sort(pool, begin, end, comp, depth_limit);
+}
+
+// Like parallel_sort, but equal elements keep their order. Needs a scratch buffer as large as
+// the range; it is move-constructed from the range, so the elements needn't be
+// default-constructible.
+template <typename Pool, typename Iterator, typename Compare = std::less<>>
+void parallel_stable_sort(Pool& pool, Iterator begin, Iterator end, Compare comp = Compare{})
+{
+    using namespace parallel_sort_detail;
+    auto const n{end - begin};
+    auto const run_count{std::clamp(
+        n / serial_cutoff, std::ptrdiff_t{1},
+        runs_per_thread * std::max<std::ptrdiff_t>(std::thread::hardware_concurrency(), 1))};
+    if (run_count == 1) {
+        std::stable_sort(begin, end, comp);
+        return;
+    }
+
+    std::vector<std::iter_value_t<Iterator>> buffer(std::make_move_iterator(begin),
+                                                    std::make_move_iterator(end));
+    // the runs are sorted in the buffer, and moved back to the range if that's where the first
+    // level of merges has to read them from
+    auto const runs_in_range{merge_levels(static_cast<std::size_t>(run_count)) % 2 == 0};
+    std::vector<run<typename decltype(buffer)::iterator>> runs{};
+    for (std::ptrdiff_t i{0}; i != run_count; ++i) {
+        runs.push_back(
+            {buffer.begin() + n * i / run_count, buffer.begin() + n * (i + 1) / run_count});
+    }
+    run_on_pool(pool, run_count, [&](std::ptrdiff_t i) {
+        auto const [b, e]{runs[static_cast<std::size_t>(i)]};
+        std::stable_sort(b, e, comp);
+        if (runs_in_range) {
+            std::move(b, e, begin + (b - buffer.begin()));
+        }
+    });
+    if (runs_in_range) {
+        std::vector<run<Iterator>> range_runs{};
+        for (auto const& [b, e] : runs) {
+            range_runs.push_back({begin + (b - buffer.begin()), begin + (e - buffer.begin())});
+        }
+        merge_all(pool, moving(range_runs), begin, buffer.begin(), comp);
+    }
+    else {
+        merge_all(pool, moving(runs), begin, buffer.begin(), comp);
+    }
+}
+
+// std::merge on the pool: merges the sorted ranges [begin1, end1) and [begin2, end2) into the
+// range starting at out - which must not overlap them - and returns the end of that range.
+template <typename Pool, typename Iterator1, typename Iterator2, typename OutputIterator,
+          typename Compare = std::less<>>
+OutputIterator parallel_merge(Pool& pool, Iterator1 begin1, Iterator1 end1, Iterator2 begin2,
+                              Iterator2 end2, OutputIterator out, Compare comp = Compare{})
+{
+    auto const n{end1 - begin1};
+    auto const m{end2 - begin2};
+    auto const count{std::max((n + m + parallel_sort_detail::merge_chunk - 1) /
+                                  parallel_sort_detail::merge_chunk,
+                              std::ptrdiff_t{1})};
+    run_on_pool(pool, count, [&](std::ptrdiff_t i) {
+        parallel_sort_detail::merge_chunk_of(begin1, n, begin2, m, (n + m) * i / count,
+                                             (n + m) * (i + 1) / count, out, comp);
+    });
+    return out + (n + m);
+}
+
+// Merges any number of sorted runs into the range starting at out, which must not overlap them
+// and must hold as many elements as the runs together. Equal elements keep the order of their
+// runs. With more than two runs it takes log2(runs.size()) levels of pairwise merges, using
+// one scratch buffer for all of them.
+template <typename Pool, typename Iterator, typename OutputIterator, typename Compare = std::less<>>
+OutputIterator parallel_multiway_merge(Pool& pool,
+                                       std::vector<std::pair<Iterator, Iterator>> const& runs,
+                                       OutputIterator out, Compare comp = Compare{})
+{
+    using namespace parallel_sort_detail;
+    std::ptrdiff_t n{0};
+    for (auto const& [b, e] : runs) {
+        n += e - b;
+    }
+    if (runs.empty()) {
+        return out;
+    }
+    if (runs.size() == 1) {
+        return std::copy(runs[0].first, runs[0].second, out);
+    }
+    if (runs.size() == 2) {
+        return parallel_merge(pool, runs[0].first, runs[0].second, runs[1].first,
+                              runs[1].second, out, comp);
+    }
+    // the last level writes to out, the one before to the buffer - which starts out as the
+    // moved-from elements of out, so that they needn't be default-constructible
+    std::vector<std::iter_value_t<OutputIterator>> buffer(std::make_move_iterator(out),
+                                                          std::make_move_iterator(out + n));
+    merge_all(pool, runs, out, buffer.begin(), comp);
+    return out + n;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel_sort.hpp"
+#include "work_stealing_thread_pool.hpp"
+
+// parallel_stable_sort on log records ordered by timestamp, where records with the same
+// timestamp have to stay in the order they were logged in, and parallel_multiway_merge on
+// shards of records that many producers have sorted already - both against their serial
+// counterparts. Pass the number of records to try other sizes.
+
+namespace
+{
+struct log_record {
+    std::uint32_t timestamp{0};
+    // the position in the log - must stay increasing among records with the same timestamp
+    std::uint64_t sequence{0};
+    std::string message{};
+};
+
+bool operator==(log_record const& a, log_record const& b)
+{
+    return a.timestamp == b.timestamp && a.sequence == b.sequence;
+}
+
+auto const by_timestamp{
+    [](log_record const& a, log_record const& b) { return a.timestamp < b.timestamp; }};
+
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
+
+void report(std::string const& name, double serial, double parallel, bool ok)
+{
+    std::cerr << std::left << std::setw(36) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << serial << std::setw(10) << parallel
+              << "    " << (ok ? "ok" : "WRONG") << "\n";
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4'000'000ul};
+    std::mt19937 rng{42};
+    // few distinct timestamps, so there are plenty of ties
+    std::uniform_int_distribution<std::uint32_t> timestamps{0, 9'999};
+
+    std::vector<log_record> log{};
+    log.reserve(size);
+    for (std::uint64_t i{0}; i != size; ++i) {
+        log.push_back({timestamps(rng), i, i % 16 == 0 ? "a message too long for SSO" : "msg"});
+    }
+
+    thread_pool pool{};
+    std::cerr << std::left << std::setw(36) << "" << std::right << std::setw(10) << "serial"
+              << std::setw(10) << "parallel" << "    (seconds)\n";
+
+    auto expected{log};
+    auto const serial_sort{seconds(
+        [&expected] { std::stable_sort(expected.begin(), expected.end(), by_timestamp); })};
+    auto sorted{log};
+    auto const parallel_sort_time{seconds([&pool, &sorted] {
+        parallel_stable_sort(pool, sorted.begin(), sorted.end(), by_timestamp);
+    })};
+    report(std::to_string(size) + " records, stable sort", serial_sort, parallel_sort_time,
+           sorted == expected);
+
+    // 64 producers, each with its own sorted shard
+    constexpr std::size_t shard_count{64};
+    std::vector<std::vector<log_record>> shards(shard_count);
+    for (std::size_t i{0}; i != log.size(); ++i) {
+        shards[i * shard_count / log.size()].push_back(log[i]);
+    }
+    std::vector<std::pair<std::vector<log_record>::const_iterator,
+                          std::vector<log_record>::const_iterator>>
+        runs{};
+    for (auto& shard : shards) {
+        std::stable_sort(shard.begin(), shard.end(), by_timestamp);
+        runs.push_back({shard.cbegin(), shard.cend()});
+    }
+    // the serial way: a heap of the runs' next elements, ties going to the earlier run
+    std::vector<log_record> serially_merged(log.size());
+    auto const serial_merge{seconds([&] {
+        auto heads{runs};
+        std::vector<std::size_t> heap(heads.size());
+        std::iota(heap.begin(), heap.end(), std::size_t{0});
+        std::erase_if(heap, [&heads](std::size_t i) { return heads[i].first == heads[i].second; });
+        auto const later{[&heads](std::size_t a, std::size_t b) {
+            auto const& x{*heads[a].first};
+            auto const& y{*heads[b].first};
+            return by_timestamp(y, x) || (!by_timestamp(x, y) && a > b);
+        }};
+        std::make_heap(heap.begin(), heap.end(), later);
+        for (auto out{serially_merged.begin()}; !heap.empty(); ++out) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            auto& head{heads[heap.back()]};
+            *out = *head.first++;
+            if (head.first == head.second) {
+                heap.pop_back();
+            }
+            else {
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    })};
+    std::vector<log_record> merged(log.size());
+    auto const parallel_merge_time{seconds([&] {
+        parallel_multiway_merge(pool, runs, merged.begin(), by_timestamp);
+    })};
+    report(std::to_string(shard_count) + " shards, multiway merge", serial_merge,
+           parallel_merge_time, merged == expected && serially_merged == expected);
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parallel_algorithms.hpp"
+#include "work_stealing_thread_pool.hpp"
+
+// Reductions over derived values - a norm, a count of matches and a weighted sum - once with
+// the transformed values stored in a temporary vector that parallel_accumulate sums up, once
+// with parallel_transform_reduce, which reads every element once and stores nothing. Pass the
+// number of elements to try other sizes.
+
+namespace
+{
+template <typename Function>
+double seconds(Function f)
+{
+    auto const start{std::chrono::steady_clock::now()};
+    f();
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
+
+template <typename T>
+void report(std::string const& name, double materialised, double fused, T a, T b)
+{
+    std::cerr << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(4) << std::setw(14) << materialised << std::setw(10) << fused
+              << "    " << (a == b ? "same result" : "DIFFERENT RESULTS") << "\n";
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto const size{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20'000'000ul};
+    std::mt19937 rng{42};
+    // small whole numbers, so that the sums are exact in any order
+    std::uniform_int_distribution<int> values{0, 100};
+    std::vector<double> scores(size);
+    std::vector<double> weights(size);
+    std::generate(scores.begin(), scores.end(), [&] { return values(rng); });
+    std::generate(weights.begin(), weights.end(), [&] { return values(rng); });
+
+    thread_pool pool{};
+    std::cerr << std::setw(16) << "" << std::setw(14) << "materialised" << std::setw(10)
+              << "fused" << "    (seconds)\n";
+
+    double materialised_norm{};
+    double fused_norm{};
+    auto const materialised_norm_time{seconds([&] {
+        std::vector<double> squares(size);
+        parallel_for_each(pool, squares.begin(), squares.end(), [&](double& square) {
+            auto const x{scores[static_cast<std::size_t>(&square - squares.data())]};
+            square = x * x;
+        });
+        materialised_norm =
+            std::sqrt(parallel_accumulate(pool, squares.cbegin(), squares.cend(), 0.0));
+    })};
+    auto const fused_norm_time{seconds([&] {
+        fused_norm = std::sqrt(parallel_transform_reduce(pool, scores.cbegin(), scores.cend(),
+                                                         0.0, std::plus<>{},
+                                                         [](double x) { return x * x; }));
+    })};
+    report("norm", materialised_norm_time, fused_norm_time, materialised_norm, fused_norm);
+
+    long materialised_count{};
+    long fused_count{};
+    auto const is_match{[](double x) { return x > 90.0 ? 1l : 0l; }};
+    auto const materialised_count_time{seconds([&] {
+        std::vector<long> matches(size);
+        parallel_for_each(pool, matches.begin(), matches.end(), [&](long& match) {
+            match = is_match(scores[static_cast<std::size_t>(&match - matches.data())]);
+        });
+        materialised_count = parallel_accumulate(pool, matches.cbegin(), matches.cend(), 0l);
+    })};
+    auto const fused_count_time{seconds([&] {
+        fused_count = parallel_transform_reduce(pool, scores.cbegin(), scores.cend(), 0l,
+                                                std::plus<>{}, is_match);
+    })};
+    report("matches", materialised_count_time, fused_count_time, materialised_count,
+           fused_count);
+
+    double materialised_sum{};
+    double fused_sum{};
+    auto const materialised_sum_time{seconds([&] {
+        std::vector<double> products(size);
+        parallel_for_each(pool, products.begin(), products.end(), [&](double& product) {
+            auto const i{static_cast<std::size_t>(&product - products.data())};
+            product = scores[i] * weights[i];
+        });
+        materialised_sum = parallel_accumulate(pool, products.cbegin(), products.cend(), 0.0);
+    })};
+    auto const fused_sum_time{seconds([&] {
+        fused_sum = parallel_transform_reduce(pool, scores.cbegin(), scores.cend(),
+                                              weights.cbegin(), 0.0);
+    })};
+    report("weighted sum", materialised_sum_time, fused_sum_time, materialised_sum, fused_sum);
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_mpmc_queue.hpp"
+#include "lock_free_queue.hpp"
+#include "node_allocator.hpp"
+#include "threadsafe_queue.hpp"
+
+// Throughput of the pool work queue candidates under contention: the two-mutex
+// threadsafe_queue (with the default and with the caching node allocator), the Michael-Scott
+// lock_free_queue and the bounded_mpmc_queue ring. Every thread alternates push() and
+// try_pop() - the latter is what pool workers use - so all of them contend on both ends, and
+// the queue never holds more than one element per thread.
+
+namespace
+{
+constexpr auto run_time = std::chrono::milliseconds{300};
+
+template <typename Queue>
+void run_benchmark(std::string const& name, unsigned thread_count)
+{
+    Queue queue{};
+    std::atomic_bool go{false};
+    std::atomic_bool done{false};
+    std::atomic<long> operations{0};
+    std::vector<std::thread> threads{};
+    for (auto t{0u}; t != thread_count; ++t) {
+        threads.emplace_back([&queue, &go, &done, &operations] {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            long local_operations{0};
+            long value{0};
+            for (long i{0}; !done.load(std::memory_order_relaxed); ++i) {
+                queue.push(i);
+                queue.try_pop(value);
+                local_operations += 2;
+            }
+            operations.fetch_add(local_operations);
+        });
+    }
+
+    go = true;
+    std::this_thread::sleep_for(run_time);
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const seconds = std::chrono::duration<double>{run_time}.count();
+
+    std::cerr << std::left << std::setw(20) << name << std::right << std::setw(10)
+              << thread_count << std::setw(16) << std::fixed << std::setprecision(2)
+              << static_cast<double>(operations.load()) / seconds / 1e6 << "\n";
+}
+} // namespace
+
+int main()
+{
+    auto const max_threads{std::max(std::thread::hardware_concurrency(), 4u)};
+    std::cerr << std::left << std::setw(20) << "queue" << std::right << std::setw(10)
+              << "threads" << std::setw(16) << "Mops/s" << "\n";
+    for (auto threads{1u}; threads <= max_threads; threads *= 2) {
+        run_benchmark<threadsafe_queue<long>>("threadsafe_queue", threads);
+        run_benchmark<threadsafe_queue<long, node_allocator<long>>>("+ node_allocator",
+                                                                     threads);
+        run_benchmark<lock_free_queue<long>>("lock_free_queue", threads);
+        run_benchmark<bounded_mpmc_queue<long>>("bounded_mpmc_queue", threads);
+    }
+}
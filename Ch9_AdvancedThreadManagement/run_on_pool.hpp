@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "task_future.hpp"
+
+/**
+ * Runs f(i) for i in [0, count): count - 1 of the calls as tasks in the pool, the last one on
+ * the calling thread, which then helps the pool until all of them are done. Pool is any of this
+ * chapter's pools. An exception from any of the calls is rethrown - once all tasks have
+ * finished, because they refer to f.
+ */
+
+template <typename Pool, typename Function>
+void run_on_pool(Pool& pool, std::ptrdiff_t count, Function const& f)
+{
+    if (count <= 0) {
+        return;
+    }
+    std::vector<task_future<void>> futures{};
+    futures.reserve(static_cast<std::size_t>(count - 1));
+    auto const wait_for_all{[&pool, &futures] {
+        for (auto const& future : futures) {
+            pool.wait(future);
+        }
+    }};
+    try {
+        for (std::ptrdiff_t i{0}; i != count - 1; ++i) {
+            futures.push_back(pool.submit([&f, i] { f(i); }));
+        }
+        f(count - 1);
+        wait_for_all();
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+    catch (...) {
+        wait_for_all();
+        throw;
+    }
+}
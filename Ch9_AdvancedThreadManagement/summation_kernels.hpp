@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Kernels that sum up the blocks of parallel_accumulate.
+ *
+ * std::accumulate adds one element after the other, so every addition waits for the one
+ * before it. For integers the compiler may reorder that on its own, for floating point it
+ * mustn't - a different order rounds differently - so a sum of doubles runs at one element
+ * per addition latency, far below what the memory could deliver. The kernels here keep
+ * accumulator_bytes worth of independent sums instead, which the compiler maps onto vector
+ * registers - four AVX-512 registers, eight AVX2 ones, or sixteen SSE ones.
+ *
+ * Integer sums always use them: they come out the same in any order. For floating point the
+ * caller picks the summation mode, and only a mode other than in_order allows the
+ * reordering. pairwise and compensated are also more accurate than adding one element after
+ * the other, and cost next to nothing on top - summing large arrays is bound by memory
+ * bandwidth anyway once the additions no longer wait for each other.
+ *
+ * For float and double in contiguous memory, the kernels are compiled for AVX-512, AVX2 and
+ * the baseline instruction set, and the program picks the best one the processor supports
+ * when it starts - GCC's and Clang's target_clones, on x86 Linux. Elsewhere they are built for
+ * whatever the compiler targets. Don't build with -ffast-math: it allows the compiler to
+ * optimise the compensation of compensated sums away.
+ *
+ * The kernels add up every lane in the same order, whatever the instruction set - the clones
+ * only differ in how many lanes they process at once - so they return the same bits on every
+ * processor. That's what the deterministic reductions build on: they cut the range into
+ * blocks of deterministic_block elements, however many threads share them, and combine the
+ * block sums in a pairwise tree whose shape only depends on the number of blocks. The same
+ * program then gets the same result on 4 cores and on 128.
+ */
+
+enum class summation {
+    // std::accumulate's order, for floating point the only deterministic one
+    in_order,
+    // any order
+    reassociate,
+    // pairwise sums of blocks: the rounding error grows with log(n) instead of n
+    pairwise,
+    // Kahan summation, in every lane: the rounding error doesn't grow with n
+    compensated,
+};
+
+// target_clones picks the clone through an ifunc, which only ELF targets like Linux support -
+// not macOS or MinGW
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__ELF__) && defined(__linux__)
+#define SUMMATION_KERNEL_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+// the templates have to be inlined into the clones to be compiled for their instruction sets
+#define SUMMATION_KERNEL_INLINE [[gnu::always_inline]] inline
+#else
+#define SUMMATION_KERNEL_CLONES
+#define SUMMATION_KERNEL_INLINE inline
+#endif
+
+namespace summation_detail {
+
+constexpr std::size_t accumulator_bytes{256};
+// pairwise summation adds up blocks of this many elements with lanes_sum
+constexpr std::ptrdiff_t pairwise_block{256};
+
+template <typename T>
+constexpr std::ptrdiff_t lanes{static_cast<std::ptrdiff_t>(
+    accumulator_bytes / sizeof(T) != 0 ? accumulator_bytes / sizeof(T) : 1)};
+
+template <typename T, typename Iterator>
+SUMMATION_KERNEL_INLINE T lanes_sum(Iterator begin, Iterator end)
+{
+    T sums[lanes<T>]{};
+    for (; end - begin >= lanes<T>; begin += lanes<T>) {
+        for (std::ptrdiff_t j{0}; j != lanes<T>; ++j) {
+            sums[j] += begin[j];
+        }
+    }
+    T res{};
+    for (; begin != end; ++begin) {
+        res += *begin;
+    }
+    for (auto const sum : sums) {
+        res += sum;
+    }
+    return res;
+}
+
+// Adds up the blocks as a binary counter does: the sum of two blocks, then the sum of two such
+// sums, and so on - so every element goes through about log2(n / pairwise_block) additions.
+// Unlike the recursive version, that can be inlined.
+template <typename T, typename Iterator>
+SUMMATION_KERNEL_INLINE T pairwise_sum(Iterator begin, Iterator end)
+{
+    // partial[level] is the sum of 2^level blocks, if present[level]
+    T partial[64]{};
+    bool present[64]{};
+    for (; end - begin > pairwise_block; begin += pairwise_block) {
+        T sum{lanes_sum<T>(begin, begin + pairwise_block)};
+        std::size_t level{0};
+        for (; present[level]; ++level) {
+            sum = partial[level] + sum;
+            present[level] = false;
+        }
+        partial[level] = sum;
+        present[level] = true;
+    }
+    T res{lanes_sum<T>(begin, end)};
+    for (std::size_t level{0}; level != 64; ++level) {
+        if (present[level]) {
+            res = partial[level] + res;
+        }
+    }
+    return res;
+}
+
+template <typename T>
+SUMMATION_KERNEL_INLINE void kahan_add(T& sum, T& compensation, T value)
+{
+    auto const y{value - compensation};
+    auto const t{sum + y};
+    // what got lost of y in rounding t
+    compensation = (t - sum) - y;
+    sum = t;
+}
+
+template <typename T, typename Iterator>
+SUMMATION_KERNEL_INLINE T compensated_sum(Iterator begin, Iterator end)
+{
+    T sums[lanes<T>]{};
+    T compensations[lanes<T>]{};
+    for (; end - begin >= lanes<T>; begin += lanes<T>) {
+        for (std::ptrdiff_t j{0}; j != lanes<T>; ++j) {
+            kahan_add(sums[j], compensations[j], begin[j]);
+        }
+    }
+    T res{};
+    T compensation{};
+    for (; begin != end; ++begin) {
+        kahan_add(res, compensation, *begin);
+    }
+    for (std::ptrdiff_t j{0}; j != lanes<T>; ++j) {
+        kahan_add(res, compensation, sums[j]);
+        kahan_add(res, compensation, -compensations[j]);
+    }
+    return res;
+}
+
+// the entry points that get compiled for several instruction sets
+SUMMATION_KERNEL_CLONES inline double reassociated(double const* begin, double const* end)
+{
+    return lanes_sum<double>(begin, end);
+}
+SUMMATION_KERNEL_CLONES inline float reassociated(float const* begin, float const* end)
+{
+    return lanes_sum<float>(begin, end);
+}
+SUMMATION_KERNEL_CLONES inline double pairwise(double const* begin, double const* end)
+{
+    return pairwise_sum<double>(begin, end);
+}
+SUMMATION_KERNEL_CLONES inline float pairwise(float const* begin, float const* end)
+{
+    return pairwise_sum<float>(begin, end);
+}
+SUMMATION_KERNEL_CLONES inline double compensated(double const* begin, double const* end)
+{
+    return compensated_sum<double>(begin, end);
+}
+SUMMATION_KERNEL_CLONES inline float compensated(float const* begin, float const* end)
+{
+    return compensated_sum<float>(begin, end);
+}
+
+template <typename T>
+constexpr bool has_clones{std::is_same_v<T, float> || std::is_same_v<T, double>};
+
+} // namespace summation_detail
+
+// The sum of [begin, end), as std::accumulate(begin, end, value_type{}) computes it, but in
+// the order mode allows.
+template <typename Iterator>
+std::iter_value_t<Iterator> sum_range(Iterator begin, Iterator end,
+                                      summation mode = summation::in_order)
+{
+    using namespace summation_detail;
+    using T = std::iter_value_t<Iterator>;
+    // the types that get promoted, like bool and char, would need casts everywhere
+    if constexpr (!std::is_arithmetic_v<T> || !std::is_same_v<decltype(T{} + T{}), T> ||
+                  !std::random_access_iterator<Iterator>) {
+        return std::accumulate(begin, end, T{});
+    }
+    else if constexpr (std::is_integral_v<T>) {
+        return lanes_sum<T>(begin, end);
+    }
+    else if constexpr (std::contiguous_iterator<Iterator> && has_clones<T>) {
+        auto const b{std::to_address(begin)};
+        auto const e{b + (end - begin)};
+        switch (mode) {
+        case summation::in_order:
+            return std::accumulate(b, e, T{});
+        case summation::reassociate:
+            return reassociated(b, e);
+        case summation::pairwise:
+            return pairwise(b, e);
+        case summation::compensated:
+            return compensated(b, e);
+        }
+        return std::accumulate(b, e, T{});
+    }
+    else {
+        switch (mode) {
+        case summation::in_order:
+            return std::accumulate(begin, end, T{});
+        case summation::reassociate:
+            return lanes_sum<T>(begin, end);
+        case summation::pairwise:
+            return pairwise_sum<T>(begin, end);
+        case summation::compensated:
+            return compensated_sum<T>(begin, end);
+        }
+        return std::accumulate(begin, end, T{});
+    }
+}
+
+constexpr std::ptrdiff_t deterministic_block{1 << 14};
+
+namespace summation_detail {
+
+// the sum of the index-th block of the deterministic reductions, n being the range's length
+template <typename T, typename Iterator>
+T block_sum(Iterator begin, std::ptrdiff_t n, std::ptrdiff_t index, summation mode)
+{
+    auto const b{std::next(begin, index * deterministic_block)};
+    auto const e{std::next(b, std::min(deterministic_block, n - index * deterministic_block))};
+    if constexpr (std::is_same_v<std::iter_value_t<Iterator>, T>) {
+        return sum_range(b, e, mode);
+    }
+    else {
+        return std::accumulate(b, e, T{});
+    }
+}
+
+template <typename T>
+T combine_block_sums(std::vector<T> const& sums)
+{
+    return pairwise_sum<T>(sums.cbegin(), sums.cend());
+}
+
+} // namespace summation_detail
+
+// The deterministic reductions, serially - they all agree with this one to the last bit.
+template <typename Iterator, typename T>
+T deterministic_accumulate(Iterator begin, Iterator end, T init,
+                           summation mode = summation::reassociate)
+{
+    auto const n{std::distance(begin, end)};
+    std::vector<T> sums(static_cast<std::size_t>((n + deterministic_block - 1) /
+                                                 deterministic_block));
+    for (std::size_t i{0}; i != sums.size(); ++i) {
+        sums[i] = summation_detail::block_sum<T>(begin, n, static_cast<std::ptrdiff_t>(i), mode);
+    }
+    return init + summation_detail::combine_block_sums(sums);
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Lightweight replacement for the std::packaged_task/std::future pair used by thread pools.
+ *
+ * The callable, its result and the completion flag share a single allocation (task_block)
+ * which is reference counted by the two handles pointing to it - the pool_task sitting in the
+ * work queue and the task_future handed back to the submitter. Completion is published through
+ * one atomic status word; there's no mutex or condition variable. A blocked get() sleeps on that
+ * word with std::atomic::wait, but pools let their callers help out instead - see
+ * thread_pool::wait().
+ */
+
+template <typename T>
+class task_state {
+    static_assert(!std::is_reference_v<T>, "task results are returned by value");
+
+public:
+    task_state(task_state const&) = delete;
+    task_state& operator=(task_state const&) = delete;
+
+    bool is_ready() const noexcept
+    {
+        return status_.load(std::memory_order_acquire) != pending;
+    }
+
+    void wait() const noexcept { status_.wait(pending, std::memory_order_acquire); }
+
+    T get()
+    {
+        wait();
+        if (status_.load(std::memory_order_relaxed) == has_exception) {
+            std::rethrow_exception(exception_);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*value_);
+        }
+    }
+
+    void add_ref() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+protected:
+    task_state() noexcept = default;
+    virtual ~task_state() noexcept = default;
+
+    template <typename Function>
+    void run(Function& f)
+    {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                f();
+            }
+            else {
+                value_.emplace(f());
+            }
+            complete(has_value);
+        }
+        catch (...) {
+            set_exception(std::current_exception());
+        }
+    }
+
+    void set_exception(std::exception_ptr e) noexcept
+    {
+        exception_ = std::move(e);
+        complete(has_exception);
+    }
+
+private:
+    struct void_result {
+    };
+    using value_type = std::conditional_t<std::is_void_v<T>, void_result, T>;
+
+    static constexpr std::uint32_t pending{0};
+    static constexpr std::uint32_t has_value{1};
+    static constexpr std::uint32_t has_exception{2};
+
+    void complete(std::uint32_t status) noexcept
+    {
+        status_.store(status, std::memory_order_release);
+        status_.notify_all();
+    }
+
+    // --- member data
+    std::atomic<std::uint32_t> status_{pending};
+    // one reference for the pool_task, one for the task_future
+    std::atomic<std::uint32_t> refs_{2};
+    std::optional<value_type> value_{};
+    std::exception_ptr exception_{};
+};
+
+template <typename Function, typename T>
+class task_block : public task_state<T> {
+public:
+    template <typename F>
+    explicit task_block(F&& f) : function_{std::in_place, std::forward<F>(f)}
+    {
+    }
+
+    void run()
+    {
+        task_state<T>::run(*function_);
+        // release whatever the callable captured as soon as it's done
+        function_.reset();
+    }
+
+    void abandon() noexcept
+    {
+        function_.reset();
+        this->set_exception(
+            std::make_exception_ptr(std::future_error{std::future_errc::broken_promise}));
+    }
+
+private:
+    std::optional<Function> function_;
+};
+
+template <typename T>
+class task_future {
+public:
+    task_future() noexcept = default;
+    explicit task_future(task_state<T>* state) noexcept : state_{state} {}
+
+    task_future(task_future&& other) noexcept : state_{std::exchange(other.state_, nullptr)} {}
+    task_future& operator=(task_future&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+        return *this;
+    }
+    task_future(task_future const&) = delete;
+    task_future& operator=(task_future const&) = delete;
+
+    ~task_future() noexcept { reset(); }
+
+    bool valid() const noexcept { return state_ != nullptr; }
+    bool is_ready() const noexcept { return state_->is_ready(); }
+    void wait() const noexcept { state_->wait(); }
+
+    // like std::future::get() this may only be called once
+    T get()
+    {
+        struct release_on_exit {
+            task_future& future;
+            ~release_on_exit() noexcept { future.reset(); }
+        } guard{*this};
+        return state_->get();
+    }
+
+private:
+    void reset() noexcept
+    {
+        if (state_) {
+            std::exchange(state_, nullptr)->release();
+        }
+    }
+
+    task_state<T>* state_{nullptr};
+};
+
+// The queue-side handle - small enough to be stored inline by function_wrapper.
+template <typename Function, typename T>
+class pool_task {
+public:
+    explicit pool_task(task_block<Function, T>* block) noexcept : block_{block} {}
+
+    pool_task(pool_task&& other) noexcept : block_{std::exchange(other.block_, nullptr)} {}
+    pool_task& operator=(pool_task&&) = delete;
+    pool_task(pool_task const&) = delete;
+    pool_task& operator=(pool_task const&) = delete;
+
+    // a task that gets destroyed without being run - e.g. on pool shutdown - must not leave
+    // its future waiting forever
+    ~pool_task() noexcept
+    {
+        if (block_) {
+            block_->abandon();
+            block_->release();
+        }
+    }
+
+    void operator()()
+    {
+        auto* const block{std::exchange(block_, nullptr)};
+        block->run();
+        block->release();
+    }
+
+private:
+    task_block<Function, T>* block_;
+};
+
+template <typename Function>
+auto make_pool_task(Function&& f)
+{
+    using function_type = std::decay_t<Function>;
+    using result_type = std::invoke_result_t<function_type&>;
+    auto* const block{new task_block<function_type, result_type>{std::forward<Function>(f)}};
+    return std::make_pair(pool_task<function_type, result_type>{block},
+                          task_future<result_type>{block});
+}
@@ -1,14 +1,25 @@
 #pragma once
 
 #include <atomic>
-#include <future>
 #include <thread>
 #include <vector>
 
+#include "bounded_mpmc_queue.hpp"
+#include "event_count.hpp"
 #include "function_wrapper.hpp"
 #include "join_threads.hpp"
+#include "lock_free_queue.hpp"
+#include "node_allocator.hpp"
+#include "task_future.hpp"
 #include "threadsafe_queue.hpp"
 
+// WorkQueue is anything with push(), try_pop(T&) and empty(): the unbounded threadsafe_queue,
+// its lock-free counterpart lock_free_queue, or a bounded_mpmc_queue. With the bounded queue
+// submit() blocks while the queue is full, which throttles producers that run ahead of the
+// workers. Don't submit from inside a task to a bounded pool then: once every worker waits
+// for room in the queue, nobody makes any.
+template <typename WorkQueue =
+              threadsafe_queue<function_wrapper, node_allocator<function_wrapper>>>
 class thread_pool {
 public:
     thread_pool()
@@ -25,35 +36,70 @@ public:
         }
     }
 
-    ~thread_pool() noexcept { done_ = true; }
+    ~thread_pool() noexcept
+    {
+        done_ = true;
+        work_available_.notify_all();
+    }
 
     template <typename Function>
-    std::future<std::invoke_result_t<Function>> submit(Function&& f)
+    task_future<std::invoke_result_t<std::decay_t<Function>&>> submit(Function&& f)
     {
-        using result_type = std::invoke_result_t<Function>;
-        std::packaged_task<result_type()> task{std::move(f)};
-        auto result{task.get_future()};
+        auto [task, result]{make_pool_task(std::forward<Function>(f))};
         work_queue_.push(std::move(task));
+        work_available_.notify_one();
         return result;
     }
 
+    void run_pending_task()
+    {
+        if (!try_run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Run pending tasks until `future` is ready, rather than blocking the thread - a task
+    // that waits for another one would otherwise take a worker out of the pool.
+    template <typename T>
+    void wait(task_future<T> const& future)
+    {
+        while (!future.is_ready()) {
+            run_pending_task();
+        }
+    }
+
 private:
+    bool try_run_pending_task()
+    {
+        function_wrapper task;
+        if (work_queue_.try_pop(task)) {
+            task();
+            return true;
+        }
+        return false;
+    }
+
     void worker_thread()
     {
+        spin_then_park idle_strategy{};
         while (!done_) {
-            function_wrapper task;
-            if (work_queue_.try_pop(task)) {
-                task();
+            if (try_run_pending_task()) {
+                idle_strategy.reset();
             }
             else {
-                std::this_thread::yield();
+                idle_strategy.idle(work_available_,
+                                   [this] { return done_ || !work_queue_.empty(); });
             }
         }
     }
 
     // --- member data
     std::atomic_bool done_{false};
-    threadsafe_queue<function_wrapper> work_queue_{};
+    WorkQueue work_queue_{};
+    event_count work_available_{};
     std::vector<std::thread> threads_{};
     join_threads joiner_{threads_};
 };
+
+using lock_free_thread_pool = thread_pool<lock_free_queue<function_wrapper>>;
+using bounded_thread_pool = thread_pool<bounded_mpmc_queue<function_wrapper>>;
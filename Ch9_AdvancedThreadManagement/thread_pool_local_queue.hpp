@@ -1,11 +1,13 @@
 #pragma once
 
-#include <future>
 #include <queue>
 #include <thread>
 
+#include "event_count.hpp"
 #include "function_wrapper.hpp"
 #include "join_threads.hpp"
+#include "node_allocator.hpp"
+#include "task_future.hpp"
 #include "threadsafe_queue.hpp"
 
 class thread_pool {
@@ -24,47 +26,76 @@ public:
         }
     }
 
-    ~thread_pool() noexcept { done_ = true; }
+    ~thread_pool() noexcept
+    {
+        done_ = true;
+        work_available_.notify_all();
+    }
 
     template <typename Function>
-    std::future<std::invoke_result_t<Function>> submit(Function&& f)
+    task_future<std::invoke_result_t<std::decay_t<Function>&>> submit(Function&& f)
     {
-        using result_type = std::invoke_result_t<Function>;
-        std::packaged_task<result_type()> task{std::move(f)};
-        auto result{task.get_future()};
+        auto [task, result]{make_pool_task(std::forward<Function>(f))};
         pool_work_queue_.push(std::move(task));
+        work_available_.notify_one();
         return result;
     }
 
     void run_pending_task()
+    {
+        if (!try_run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Help out with pending tasks until `future` is ready, rather than blocking the thread -
+    // the task we're waiting on may well be sitting in one of our queues.
+    template <typename T>
+    void wait(task_future<T> const& future)
+    {
+        while (!future.is_ready()) {
+            run_pending_task();
+        }
+    }
+
+private:
+    bool try_run_pending_task()
     {
         function_wrapper task;
         if (local_work_queue_ && !local_work_queue_->empty()) {
             task = std::move(local_work_queue_->front());
             local_work_queue_->pop();
             task();
+            return true;
         }
         if (pool_work_queue_.try_pop(task)) {
             task();
+            return true;
         }
-        else {
-            std::this_thread::yield();
-        }
+        return false;
     }
 
-private:
     void worker_thread()
     {
         local_work_queue_ = std::make_unique<local_queue_type>();
 
+        spin_then_park idle_strategy{};
         while (!done_) {
-            run_pending_task();
+            if (try_run_pending_task()) {
+                idle_strategy.reset();
+            }
+            else {
+                // the local queue is empty here and only this thread can fill it
+                idle_strategy.idle(work_available_,
+                                   [this] { return done_ || !pool_work_queue_.empty(); });
+            }
         }
     }
 
     // --- member data
     std::atomic_bool done_{false};
-    threadsafe_queue<function_wrapper> pool_work_queue_{};
+    threadsafe_queue<function_wrapper, node_allocator<function_wrapper>> pool_work_queue_{};
+    event_count work_available_{};
     std::vector<std::thread> threads_{};
     join_threads joiner_{threads_};
     using local_queue_type = std::queue<function_wrapper>;
@@ -4,42 +4,71 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <utility>
 
-template <typename T>
+// Nodes are allocated through Allocator (rebound to the node type), and the values are stored
+// in the nodes themselves, so a push costs a single node allocation. Popping into a T& doesn't
+// allocate at all; the shared_ptr returning pops allocate the result through Allocator, too.
+template <typename T, typename Allocator = std::allocator<T>>
 class threadsafe_queue {
   private:
+    struct node;
+    using node_allocator_type =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator_type>;
+
+    struct node_deleter {
+        node_allocator_type allocator{};
+
+        void operator()(node* p) noexcept
+        {
+            node_traits::destroy(allocator, p);
+            node_traits::deallocate(allocator, p, 1);
+        }
+    };
+    using node_ptr = std::unique_ptr<node, node_deleter>;
+
     struct node {
-        std::shared_ptr<T> data{nullptr};
-        std::unique_ptr<node> next{nullptr};
+        std::optional<T> data{};
+        node_ptr next{nullptr};
     };
 
     // --- member data
-    std::unique_ptr<node> head_{std::make_unique<node>()};
+    node_allocator_type allocator_{};
+    node_ptr head_{make_node()};
     node* tail_{head_.get()};
     mutable std::mutex head_mutex_{};
     mutable std::mutex tail_mutex_{};
     std::condition_variable cv_{};
 
     // helper functions
+    node_ptr make_node();
     node* get_tail();
-    std::unique_ptr<node> pop_head();
+    node const* get_tail() const;
+    node_ptr pop_head();
+    std::shared_ptr<T> pop_head_value();
     std::unique_lock<std::mutex> wait_for_data();
     template <typename Clock>
     std::pair<std::unique_lock<std::mutex>, bool>
     wait_for_data_until(std::chrono::time_point<Clock> deadline);
-    std::unique_ptr<node> wait_pop_head();
-    std::unique_ptr<node> wait_pop_head(T& value);
+    std::shared_ptr<T> wait_pop_head();
+    node_ptr wait_pop_head(T& value);
     template <typename Clock>
-    std::unique_ptr<node> wait_pop_head_until(std::chrono::time_point<Clock> deadline);
+    std::shared_ptr<T> wait_pop_head_until(std::chrono::time_point<Clock> deadline);
     template <typename Clock>
     bool wait_pop_head_until(T& value, std::chrono::time_point<Clock> deadline);
-    std::unique_ptr<node> try_pop_head();
-    std::unique_ptr<node> try_pop_head(T& value);
-    void push_new_data(std::shared_ptr<T> new_data);
+    std::shared_ptr<T> try_pop_head();
+    node_ptr try_pop_head(T& value);
+    template <typename... Args>
+    void push_new_data(Args&&... args);
 
   public:
     threadsafe_queue() = default;
+    explicit threadsafe_queue(Allocator const& allocator)
+        : allocator_{allocator}
+    {
+    }
     threadsafe_queue(threadsafe_queue const&) = delete;
     threadsafe_queue(threadsafe_queue&&) noexcept = delete;
     threadsafe_queue& operator=(threadsafe_queue const&) = delete;
@@ -61,170 +90,184 @@ class threadsafe_queue {
 };
 
 // helper functions
-template <typename T>
-auto threadsafe_queue<T>::pop_head() -> std::unique_ptr<node>
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::make_node() -> node_ptr
+{
+    auto* const p{node_traits::allocate(allocator_, 1)};
+    node_traits::construct(allocator_, p);
+    return node_ptr{p, node_deleter{allocator_}};
+}
+
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::pop_head() -> node_ptr
 {
     auto old_head{std::move(head_)};
     head_ = std::move(old_head->next);
     return old_head;
 }
 
-template <typename T>
-auto threadsafe_queue<T>::get_tail() -> node*
+template <typename T, typename Allocator>
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::pop_head_value()
+{
+    // allocate before unlinking - if that throws, the queue is left untouched
+    auto res{std::allocate_shared<T>(allocator_, std::move(*head_->data))};
+    pop_head();
+    return res;
+}
+
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::get_tail() -> node*
+{
+    std::lock_guard<std::mutex> lock{tail_mutex_};
+    return tail_;
+}
+
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::get_tail() const -> node const*
 {
     std::lock_guard<std::mutex> lock{tail_mutex_};
     return tail_;
 }
 
-template <typename T>
-std::unique_lock<std::mutex> threadsafe_queue<T>::wait_for_data()
+template <typename T, typename Allocator>
+std::unique_lock<std::mutex> threadsafe_queue<T, Allocator>::wait_for_data()
 {
     std::unique_lock<std::mutex> lock{head_mutex_};
     cv_.wait(lock, [this] { return head_.get() != get_tail(); });
     return lock; // might need std::move(lock) pre C++17
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename Clock>
 std::pair<std::unique_lock<std::mutex>, bool>
-threadsafe_queue<T>::wait_for_data_until(std::chrono::time_point<Clock> deadline)
+threadsafe_queue<T, Allocator>::wait_for_data_until(std::chrono::time_point<Clock> deadline)
 {
     std::unique_lock<std::mutex> lock{head_mutex_};
     auto const res{cv_.wait_until(lock, deadline, [this] { return head_.get() != get_tail(); })};
     return {std::move(lock), res};
 }
 
-template <typename T>
-auto threadsafe_queue<T>::wait_pop_head() -> std::unique_ptr<node>
+template <typename T, typename Allocator>
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::wait_pop_head()
 {
     std::unique_lock<std::mutex> lock{wait_for_data()};
-    return pop_head();
+    return pop_head_value();
 }
 
-template <typename T>
-auto threadsafe_queue<T>::wait_pop_head(T& value) -> std::unique_ptr<node>
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::wait_pop_head(T& value) -> node_ptr
 {
     std::unique_lock<std::mutex> lock{wait_for_data()};
-    auto const pdata = std::move(head_->data);
     auto old_head = pop_head();
     lock.unlock();
-    value = std::move(*pdata);
+    value = std::move(*old_head->data);
     return old_head;
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename Clock>
-auto threadsafe_queue<T>::wait_pop_head_until(std::chrono::time_point<Clock> deadline)
-    -> std::unique_ptr<node>
+std::shared_ptr<T>
+threadsafe_queue<T, Allocator>::wait_pop_head_until(std::chrono::time_point<Clock> deadline)
 {
     auto [lock, data_available]{wait_for_data_until(deadline)};
     if (!data_available) {
         return nullptr;
     }
-    return pop_head();
+    return pop_head_value();
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename Clock>
-bool threadsafe_queue<T>::wait_pop_head_until(T& value, std::chrono::time_point<Clock> deadline)
+bool threadsafe_queue<T, Allocator>::wait_pop_head_until(T& value, std::chrono::time_point<Clock> deadline)
 {
     auto [lock, data_available]{wait_for_data_until(deadline)};
     if (!data_available) {
         return false;
     }
-    auto const pdata = std::move(head_->data);
-    pop_head();
+    auto const old_head = pop_head();
     lock.unlock();
-    value = std::move(*pdata);
+    value = std::move(*old_head->data);
     return true;
 }
 
-template <typename T>
-auto threadsafe_queue<T>::try_pop_head() -> std::unique_ptr<node>
+template <typename T, typename Allocator>
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::try_pop_head()
 {
     std::lock_guard<std::mutex> lock{head_mutex_};
     if (head_.get() == get_tail()) {
         return {};
     }
-    return pop_head();
+    return pop_head_value();
 }
 
-template <typename T>
-auto threadsafe_queue<T>::try_pop_head(T& value) -> std::unique_ptr<node>
+template <typename T, typename Allocator>
+auto threadsafe_queue<T, Allocator>::try_pop_head(T& value) -> node_ptr
 {
     std::unique_lock<std::mutex> lock{head_mutex_};
     if (head_.get() == get_tail()) {
         return {};
     }
-    auto const pdata = std::move(head_->data);
     auto old_head = pop_head();
     lock.unlock();
-    value = std::move(*pdata);
+    value = std::move(*old_head->data);
     return old_head;
 }
 
-template <typename T>
-std::shared_ptr<T> threadsafe_queue<T>::try_pop()
+template <typename T, typename Allocator>
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::try_pop()
 {
-    auto const old_head{try_pop_head()};
-    if (nullptr == old_head) {
-        return {};
-    }
-    return old_head->data;
+    return try_pop_head();
 }
 
-template <typename T>
-bool threadsafe_queue<T>::try_pop(T& value)
+template <typename T, typename Allocator>
+bool threadsafe_queue<T, Allocator>::try_pop(T& value)
 {
     auto const old_head{try_pop_head(value)};
     return nullptr != old_head;
 }
 
-template <typename T>
-bool threadsafe_queue<T>::empty() const
+template <typename T, typename Allocator>
+bool threadsafe_queue<T, Allocator>::empty() const
 {
     std::lock_guard<std::mutex> lock{head_mutex_};
     return head_.get() == get_tail();
 }
 
-template <typename T>
-std::shared_ptr<T> threadsafe_queue<T>::wait_and_pop()
+template <typename T, typename Allocator>
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::wait_and_pop()
 {
-    auto const old_head{wait_pop_head()};
-    return std::move(old_head->data);
+    return wait_pop_head();
 }
 
-template <typename T>
-void threadsafe_queue<T>::wait_and_pop(T& value)
+template <typename T, typename Allocator>
+void threadsafe_queue<T, Allocator>::wait_and_pop(T& value)
 {
     auto const old_head{wait_pop_head(value)};
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename Clock>
-std::shared_ptr<T> threadsafe_queue<T>::wait_and_pop_until(std::chrono::time_point<Clock> deadline)
+std::shared_ptr<T> threadsafe_queue<T, Allocator>::wait_and_pop_until(std::chrono::time_point<Clock> deadline)
 {
-    auto const old_head{wait_pop_head_until(deadline)};
-    if (nullptr != old_head) {
-        return std::move(old_head->data);
-    }
-    return nullptr;
+    return wait_pop_head_until(deadline);
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename Clock>
-bool threadsafe_queue<T>::wait_and_pop_until(T& value, std::chrono::time_point<Clock> deadline)
+bool threadsafe_queue<T, Allocator>::wait_and_pop_until(T& value, std::chrono::time_point<Clock> deadline)
 {
     return wait_pop_head_until(value, deadline);
 }
 
-template <typename T>
-void threadsafe_queue<T>::push_new_data(std::shared_ptr<T> new_data)
+template <typename T, typename Allocator>
+template <typename... Args>
+void threadsafe_queue<T, Allocator>::push_new_data(Args&&... args)
 {
-    auto p{std::make_unique<node>()};
+    auto p{make_node()};
     {
         std::lock_guard<std::mutex> lock{tail_mutex_};
-        tail_->data = std::move(new_data);
+        // if constructing the value throws, the queue is left untouched
+        tail_->data.emplace(std::forward<Args>(args)...);
         node* const new_tail{p.get()};
         tail_->next = std::move(p);
         tail_ = new_tail;
@@ -232,18 +275,18 @@ void threadsafe_queue<T>::push_new_data(std::shared_ptr<T> new_data)
     cv_.notify_one();
 }
 
-template <typename T>
-void threadsafe_queue<T>::push(T new_value)
+template <typename T, typename Allocator>
+void threadsafe_queue<T, Allocator>::push(T new_value)
 {
-    push_new_data(std::make_shared<T>(std::move(new_value)));
+    push_new_data(std::move(new_value));
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 template <typename... Args>
 std::enable_if_t<std::is_constructible_v<T, Args...>>
-threadsafe_queue<T>::emplace(Args&&... args)
+threadsafe_queue<T, Allocator>::emplace(Args&&... args)
 {
-    push_new_data(std::make_shared<T>(std::forward<Args>(args)...));
+    push_new_data(std::forward<Args>(args)...);
 }
 
 #endif // THREADSAFE_QUEUE_HPP_
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * The owning thread pushes and pops at the bottom (LIFO), which keeps recently spawned - and
+ * therefore cache-hot - tasks on the thread that created them. Any other thread may steal from
+ * the top (FIFO), taking the oldest, usually largest, pieces of work.
+ * push() and try_pop() must only ever be called by the owner, try_steal() is safe from any thread.
+ *
+ * Elements are owned through raw pointers held in atomics - a thief reads a slot before it knows
+ * whether its claim on it will succeed, so the slots themselves have to be safe to read racily.
+ * Memory orderings follow Le, Pop, Cohen, Zappa Nardelli -
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP'13).
+ */
+
+template <typename T>
+class work_stealing_queue {
+  private:
+    using index_type = std::int64_t;
+
+    class circular_array {
+      public:
+        explicit circular_array(index_type capacity)
+            : mask_{capacity - 1}, slots_{std::make_unique<std::atomic<T*>[]>(
+                                       static_cast<std::size_t>(capacity))}
+        {
+        }
+
+        index_type capacity() const noexcept { return mask_ + 1; }
+
+        T* load(index_type i) const noexcept
+        {
+            return slots_[static_cast<std::size_t>(i & mask_)].load(std::memory_order_relaxed);
+        }
+
+        void store(index_type i, T* value) noexcept
+        {
+            slots_[static_cast<std::size_t>(i & mask_)].store(value, std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<circular_array> grow(index_type bottom, index_type top) const
+        {
+            auto bigger{std::make_unique<circular_array>(capacity() * 2)};
+            for (auto i{top}; i != bottom; ++i) {
+                bigger->store(i, load(i));
+            }
+            return bigger;
+        }
+
+      private:
+        index_type mask_;
+        std::unique_ptr<std::atomic<T*>[]> slots_;
+    };
+
+    static constexpr index_type initial_capacity{64};
+
+    // --- member data
+    // top_ is hammered by thieves, bottom_ by the owner - keep them on separate cache lines
+    alignas(64) std::atomic<index_type> top_{0};
+    alignas(64) std::atomic<index_type> bottom_{0};
+    std::atomic<circular_array*> array_{nullptr};
+    // Thieves may still be reading from an array that has been replaced by a bigger one, so
+    // retired arrays are only released together with the queue itself.
+    std::vector<std::unique_ptr<circular_array>> arrays_{};
+
+  public:
+    work_stealing_queue()
+    {
+        arrays_.push_back(std::make_unique<circular_array>(initial_capacity));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_queue(work_stealing_queue const&) = delete;
+    work_stealing_queue& operator=(work_stealing_queue const&) = delete;
+
+    ~work_stealing_queue() noexcept
+    {
+        while (try_pop())
+            ;
+    }
+
+    void push(std::unique_ptr<T> item)
+    {
+        auto const b{bottom_.load(std::memory_order_relaxed)};
+        auto const t{top_.load(std::memory_order_acquire)};
+        auto* a{array_.load(std::memory_order_relaxed)};
+        if (b - t > a->capacity() - 1) {
+            arrays_.push_back(a->grow(b, t));
+            a = arrays_.back().get();
+            array_.store(a, std::memory_order_release);
+        }
+        a->store(b, item.release());
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<T> try_pop()
+    {
+        auto const b{bottom_.load(std::memory_order_relaxed) - 1};
+        auto* const a{array_.load(std::memory_order_relaxed)};
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t{top_.load(std::memory_order_relaxed)};
+        if (t > b) {
+            // empty - restore bottom
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item{a->load(b)};
+        if (t == b) {
+            // last element - race against thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return std::unique_ptr<T>{item};
+    }
+
+    std::unique_ptr<T> try_steal()
+    {
+        auto t{top_.load(std::memory_order_acquire)};
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const b{bottom_.load(std::memory_order_acquire)};
+        if (t >= b) {
+            return nullptr;
+        }
+        auto* const a{array_.load(std::memory_order_acquire)};
+        T* const item{a->load(t)};
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            // lost the race against the owner or another thief
+            return nullptr;
+        }
+        return std::unique_ptr<T>{item};
+    }
+
+    bool empty() const noexcept
+    {
+        auto const t{top_.load(std::memory_order_relaxed)};
+        auto const b{bottom_.load(std::memory_order_relaxed)};
+        return b <= t;
+    }
+};
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "work_stealing_thread_pool.hpp"
+
+// Fork-join sum - every level submits its left half back to the pool and recurses into the
+// right half, so almost all tasks are spawned by workers and land on their local deques.
+// Idle workers only find work by stealing.
+template <typename Iterator>
+long long recursive_sum(thread_pool& pool, Iterator begin, Iterator end)
+{
+    auto const length{std::distance(begin, end)};
+    if (length < 1000) {
+        return std::accumulate(begin, end, 0ll);
+    }
+    auto const middle{std::next(begin, length / 2)};
+    auto left{pool.submit([&pool, begin, middle] { return recursive_sum(pool, begin, middle); })};
+    auto const right{recursive_sum(pool, middle, end)};
+    // help out instead of blocking - the task we're waiting for may still be in our own deque
+    pool.wait(left);
+    return left.get() + right;
+}
+
+int main()
+{
+    std::vector<int> data(1'000'000);
+    std::iota(data.begin(), data.end(), 0);
+
+    thread_pool pool{};
+    auto result{pool.submit([&pool, &data] { return recursive_sum(pool, data.cbegin(), data.cend()); })};
+    std::cerr << "recursive_sum = " << result.get() << "\n";
+    std::cerr << "expected      = " << std::accumulate(data.cbegin(), data.cend(), 0ll) << "\n";
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "event_count.hpp"
+#include "function_wrapper.hpp"
+#include "join_threads.hpp"
+#include "node_allocator.hpp"
+#include "task_future.hpp"
+#include "threadsafe_queue.hpp"
+#include "work_stealing_queue.hpp"
+
+/**
+ * Thread pool with per-worker work-stealing deques.
+ *
+ * Tasks submitted from outside the pool go to the shared injection queue. Tasks submitted by a
+ * worker - e.g. the recursive halves of a divide-and-conquer algorithm - go to that worker's
+ * own deque, from which it pops LIFO. A worker that runs out of local work first checks the
+ * injection queue and then tries to steal the oldest task from the other workers, visiting them
+ * starting from a random victim so that thieves don't all pile onto the same deque.
+ */
+
+class thread_pool {
+public:
+    thread_pool()
+    {
+        auto const thread_count{std::max(std::thread::hardware_concurrency(), 1u)};
+        try {
+            for (auto i{0u}; i != thread_count; ++i) {
+                queues_.push_back(std::make_unique<task_queue_type>());
+            }
+            for (auto i{0u}; i != thread_count; ++i) {
+                threads_.push_back(std::thread{&thread_pool::worker_thread, this, i});
+            }
+        }
+        catch (...) {
+            done_ = true;
+            throw;
+        }
+    }
+
+    ~thread_pool() noexcept
+    {
+        done_ = true;
+        work_available_.notify_all();
+    }
+
+    template <typename Function>
+    task_future<std::invoke_result_t<std::decay_t<Function>&>> submit(Function&& f)
+    {
+        auto [task, result]{make_pool_task(std::forward<Function>(f))};
+        if (local_work_queue_ && local_pool_ == this) {
+            local_work_queue_->push(std::make_unique<function_wrapper>(std::move(task)));
+        }
+        else {
+            pool_work_queue_.push(std::move(task));
+        }
+        // wake one sleeper - it can steal the task if it landed in a local deque
+        work_available_.notify_one();
+        return result;
+    }
+
+    void run_pending_task()
+    {
+        if (!try_run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Help out with pending tasks until `future` is ready, rather than blocking the thread -
+    // the task we're waiting on may well be sitting in one of our queues.
+    template <typename T>
+    void wait(task_future<T> const& future)
+    {
+        while (!future.is_ready()) {
+            run_pending_task();
+        }
+    }
+
+private:
+    using task_queue_type = work_stealing_queue<function_wrapper>;
+
+    bool try_run_pending_task()
+    {
+        function_wrapper task;
+        if (pop_task_from_local_queue(task) || pop_task_from_pool_queue(task) ||
+            pop_task_from_other_thread_queue(task)) {
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    bool work_available() const
+    {
+        return !pool_work_queue_.empty() ||
+               std::any_of(queues_.cbegin(), queues_.cend(),
+                           [](auto const& queue) { return !queue->empty(); });
+    }
+
+    void worker_thread(unsigned index)
+    {
+        my_index_ = index;
+        local_pool_ = this;
+        local_work_queue_ = queues_[index].get();
+        victim_rng_.seed(index + 1);
+        spin_then_park idle_strategy{};
+        while (!done_) {
+            if (try_run_pending_task()) {
+                idle_strategy.reset();
+            }
+            else {
+                idle_strategy.idle(work_available_, [this] { return done_ || work_available(); });
+            }
+        }
+        local_work_queue_ = nullptr;
+        local_pool_ = nullptr;
+    }
+
+    bool pop_task_from_local_queue(function_wrapper& task)
+    {
+        if (!local_work_queue_ || local_pool_ != this) {
+            return false;
+        }
+        if (auto p_task{local_work_queue_->try_pop()}) {
+            task = std::move(*p_task);
+            return true;
+        }
+        return false;
+    }
+
+    bool pop_task_from_pool_queue(function_wrapper& task)
+    {
+        return pool_work_queue_.try_pop(task);
+    }
+
+    bool pop_task_from_other_thread_queue(function_wrapper& task)
+    {
+        auto const queue_count{queues_.size()};
+        auto const first_victim{victim_rng_() % queue_count};
+        for (auto i{0u}; i != queue_count; ++i) {
+            auto const victim{(first_victim + i) % queue_count};
+            if (local_pool_ == this && victim == my_index_) {
+                continue;
+            }
+            if (auto p_task{queues_[victim]->try_steal()}) {
+                task = std::move(*p_task);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // --- member data
+    std::atomic_bool done_{false};
+    threadsafe_queue<function_wrapper, node_allocator<function_wrapper>> pool_work_queue_{};
+    event_count work_available_{};
+    std::vector<std::unique_ptr<task_queue_type>> queues_{};
+    std::vector<std::thread> threads_{};
+    join_threads joiner_{threads_};
+
+    static thread_local thread_pool* local_pool_;
+    static thread_local task_queue_type* local_work_queue_;
+    static thread_local unsigned my_index_;
+    static thread_local std::minstd_rand victim_rng_;
+};
+
+thread_local thread_pool* thread_pool::local_pool_{nullptr};
+thread_local thread_pool::task_queue_type* thread_pool::local_work_queue_{nullptr};
+thread_local unsigned thread_pool::my_index_{0};
+thread_local std::minstd_rand thread_pool::victim_rng_{};